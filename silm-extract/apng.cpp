@@ -0,0 +1,213 @@
+//
+//  apng.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "apng.hpp"
+#include "blit.hpp"
+#include "png_encoder.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void put4b(std::vector<uint8_t>& out, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+    out.insert(out.end(), b, b + 4);
+}
+
+static void put2b(std::vector<uint8_t>& out, uint16_t v)
+{
+    uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+    out.insert(out.end(), b, b + 2);
+}
+
+static void put_chunk(FILE *fp, const char *type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    png_encoder::chunk(chunk, type, data.data(), (uint32_t)data.size());
+    
+    if (fwrite(chunk.data(), chunk.size(), 1, fp) != 1)
+        abort();
+}
+
+apng_writer::apng_writer(int width, int height, int bytes_per_pixel, const uint8_t *palette, int clear)
+{
+    _width = width;
+    _height = height;
+    _bpp = bytes_per_pixel;
+    _clear = clear >= 0 && clear < 256 ? clear : -1;
+    
+    memset(_palette, 0, sizeof(_palette));
+    if (palette)
+        memcpy(_palette, palette, sizeof(_palette));
+}
+
+void apng_writer::add_frame(const uint8_t *pixels, uint16_t delay_num, uint16_t delay_den)
+{
+    int stride = _width * _bpp;
+    
+    frame f;
+    f.delay_num = delay_num;
+    f.delay_den = delay_den;
+    f.x = 0;
+    f.y = 0;
+    f.width = _width;
+    f.height = _height;
+    
+    if (_canvas.empty())
+    {
+        _canvas.assign(pixels, pixels + stride * _height);
+    }
+    else
+    {
+        // bounding box of changed pixels
+        
+        int left = stride, right = -1, top = -1, bottom = -1;
+        for (int y = 0; y < _height; y++)
+        {
+            int first, last;
+            if (blit::diff(_canvas.data() + y * stride, pixels + y * stride, stride, first, last))
+            {
+                if (top < 0)
+                    top = y;
+                
+                bottom = y;
+                left = std::min(left, first / _bpp);
+                right = std::max(right, last / _bpp);
+                memcpy(_canvas.data() + y * stride, pixels + y * stride, stride);
+            }
+        }
+        
+        // NOTE: frames can't be empty, unchanged frame repeats one pixel
+        
+        if (top < 0)
+        {
+            left = right = top = bottom = 0;
+        }
+        
+        f.x = left;
+        f.y = top;
+        f.width = right - left + 1;
+        f.height = bottom - top + 1;
+    }
+    
+    compress(_canvas.data(), f.x, f.y, f.width, f.height, f.data);
+    _frames.push_back(std::move(f));
+}
+
+void apng_writer::compress(const uint8_t *pixels, int x, int y, int width, int height, std::vector<uint8_t>& out)
+{
+    // filter none for indexed, sub for RGBA
+    
+    int bytes = width * _bpp;
+    std::vector<uint8_t> raw((bytes + 1) * height);
+    
+    uint8_t *to = raw.data();
+    for (int r = 0; r < height; r++)
+    {
+        const uint8_t *row = pixels + (y + r) * _width * _bpp + x * _bpp;
+        if (_bpp == 1)
+        {
+            *to++ = 0;
+            memcpy(to, row, bytes);
+        }
+        else
+        {
+            *to++ = 1;
+            memcpy(to, row, _bpp);
+            for (int b = _bpp; b < bytes; b++)
+                to[b] = row[b] - row[b - _bpp];
+        }
+        
+        to += bytes;
+    }
+    
+    png_encoder::local().compress(raw.data(), raw.size(), out, _bpp == 1 ? Z_DEFAULT_STRATEGY : Z_FILTERED);
+}
+
+void apng_writer::save(const char *filename)
+{
+    if (_frames.empty())
+        return;
+    
+    FILE *fp = utils::open_output(filename);
+    if (!fp)
+        abort();
+    
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    if (fwrite(signature, sizeof(signature), 1, fp) != 1)
+        abort();
+    
+    std::vector<uint8_t> data;
+    put4b(data, _width);
+    put4b(data, _height);
+    data.push_back(8);
+    data.push_back(_bpp == 1 ? 3 : 6);
+    data.push_back(0);
+    data.push_back(0);
+    data.push_back(0);
+    put_chunk(fp, "IHDR", data);
+    
+    bool animated = _frames.size() > 1;
+    if (animated)
+    {
+        data.clear();
+        put4b(data, (uint32_t)_frames.size());
+        put4b(data, 0);
+        put_chunk(fp, "acTL", data);
+    }
+    
+    if (_bpp == 1)
+    {
+        put_chunk(fp, "PLTE", std::vector<uint8_t>(_palette, _palette + 256 * 3));
+        
+        if (_clear >= 0)
+        {
+            data.assign(_clear + 1, 0xff);
+            data[_clear] = 0;
+            put_chunk(fp, "tRNS", data);
+        }
+    }
+    
+    uint32_t sequence = 0;
+    for (size_t i = 0; i < _frames.size(); i++)
+    {
+        const frame& f = _frames[i];
+        
+        if (animated)
+        {
+            data.clear();
+            put4b(data, sequence++);
+            put4b(data, f.width);
+            put4b(data, f.height);
+            put4b(data, f.x);
+            put4b(data, f.y);
+            put2b(data, f.delay_num);
+            put2b(data, f.delay_den);
+            data.push_back(0); // APNG_DISPOSE_OP_NONE
+            data.push_back(0); // APNG_BLEND_OP_SOURCE
+            put_chunk(fp, "fcTL", data);
+        }
+        
+        if (i == 0)
+        {
+            put_chunk(fp, "IDAT", f.data);
+        }
+        else
+        {
+            data.clear();
+            put4b(data, sequence++);
+            data.insert(data.end(), f.data.begin(), f.data.end());
+            put_chunk(fp, "fdAT", data);
+        }
+    }
+    
+    put_chunk(fp, "IEND", std::vector<uint8_t>());
+    utils::close_output(fp, filename);
+}
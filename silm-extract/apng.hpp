@@ -0,0 +1,50 @@
+//
+//  apng.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef apng_hpp
+#define apng_hpp
+
+#include <stdint.h>
+#include <vector>
+
+// Animated PNG (indexed or RGBA). Every frame after the first one only stores
+// the rectangle that changed since previous frame. A single frame is saved as plain PNG.
+
+class apng_writer {
+    
+public:
+    
+    apng_writer(int width, int height, int bytes_per_pixel, const uint8_t *palette = NULL, int clear = -1);
+
+    void add_frame(const uint8_t *pixels, uint16_t delay_num = 1, uint16_t delay_den = 10);
+    void save(const char *filename);
+
+    int frames() const { return (int)_frames.size(); }
+    
+private:
+    
+    struct frame {
+        
+        int x, y;
+        int width, height;
+        uint16_t delay_num, delay_den;
+        std::vector<uint8_t> data; // deflated rows
+    };
+    
+    void compress(const uint8_t *pixels, int x, int y, int width, int height, std::vector<uint8_t>& out);
+    
+    int _width;
+    int _height;
+    int _bpp;
+    uint8_t _palette[256 * 3];
+    int _clear; // transparent index, -1 for none
+    
+    std::vector<uint8_t> _canvas;
+    std::vector<frame> _frames;
+};
+
+#endif /* apng_hpp */
@@ -0,0 +1,110 @@
+//
+//  atlas.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "atlas.hpp"
+
+#include <algorithm>
+#include <climits>
+
+skyline_packer::skyline_packer(int width, int height)
+{
+    _width = width;
+    _height = height;
+    _used_width = 0;
+    _used_height = 0;
+    _skyline.push_back({ 0, 0, width });
+}
+
+// y where rectangle starting at node index rests, -1 if it does not fit
+int skyline_packer::fit(size_t index, int width, int height) const
+{
+    int x = _skyline[index].x;
+    if (x + width > _width)
+        return -1;
+    
+    int y = 0;
+    int left = width;
+    for (size_t i = index; left > 0; i++)
+    {
+        if (i == _skyline.size())
+            return -1;
+        
+        y = std::max(y, _skyline[i].y);
+        if (y + height > _height)
+            return -1;
+        
+        left -= _skyline[i].width;
+    }
+    
+    return y;
+}
+
+bool skyline_packer::insert(int width, int height, int& x, int& y)
+{
+    int best = -1;
+    int best_top = INT_MAX;
+    int best_x = INT_MAX;
+    
+    for (size_t i = 0; i < _skyline.size(); i++)
+    {
+        int at = fit(i, width, height);
+        if (at >= 0 && (at + height < best_top || (at + height == best_top && _skyline[i].x < best_x)))
+        {
+            best = (int)i;
+            best_top = at + height;
+            best_x = _skyline[i].x;
+            y = at;
+        }
+    }
+    
+    if (best < 0)
+        return false;
+    
+    x = best_x;
+    
+    // new node covers the rectangle, nodes below it shrink or go away
+    
+    _skyline.insert(_skyline.begin() + best, { x, y + height, width });
+    
+    for (size_t i = best + 1; i < _skyline.size(); )
+    {
+        node& n = _skyline[i];
+        int end = x + width;
+        if (n.x >= end)
+            break;
+        
+        int cut = end - n.x;
+        if (cut >= n.width)
+        {
+            _skyline.erase(_skyline.begin() + i);
+            continue;
+        }
+        
+        n.x += cut;
+        n.width -= cut;
+        break;
+    }
+    
+    // merge neighbours of same height
+    
+    for (size_t i = 0; i + 1 < _skyline.size(); )
+    {
+        if (_skyline[i].y == _skyline[i + 1].y)
+        {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+    
+    _used_width = std::max(_used_width, x + width);
+    _used_height = std::max(_used_height, y + height);
+    return true;
+}
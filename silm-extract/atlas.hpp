@@ -0,0 +1,46 @@
+//
+//  atlas.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef atlas_hpp
+#define atlas_hpp
+
+#include <vector>
+
+// Skyline bottom-left rectangle packer. Each rectangle is put where its top edge
+// ends lowest (leftmost on ties), space below the skyline is not reused.
+
+class skyline_packer {
+    
+public:
+    
+    skyline_packer(int width, int height);
+
+    bool insert(int width, int height, int& x, int& y);
+
+    int used_width() const { return _used_width; }
+    int used_height() const { return _used_height; }
+
+private:
+    
+    struct node {
+        
+        int x;
+        int y;
+        int width;
+    };
+    
+    int fit(size_t index, int width, int height) const;
+    
+    int _width;
+    int _height;
+    int _used_width;
+    int _used_height;
+    
+    std::vector<node> _skyline;
+};
+
+#endif /* atlas_hpp */
@@ -0,0 +1,302 @@
+//
+//  audio.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "audio.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// signed deltas for every nibble
+static const int8_t tfibo[16] = {
+    -34, -21, -13, -8,
+     -5,  -3,  -2, -1,
+      1,   2,   3,  5,
+      8,  13,  21, 34 };
+
+uint32_t audio::decode_fibonacci(const uint8_t *packed, uint32_t packed_length, uint8_t *out, uint32_t out_length)
+{
+    if (packed_length == 0 || out_length == 0)
+        return 0;
+
+    // every byte after the first one holds two deltas (high nibble first)
+    
+    uint32_t count = std::min(out_length, 1 + (packed_length - 1) * 2);
+
+    // NOTE: samples are signed, adding 0x80 to start value converts whole sample to unsigned PCM (wav doesn't support signed 8 bit)
+
+    uint8_t value = packed[0] ^ 0x80;
+    out[0] = value;
+    
+    uint32_t at = 1;
+    uint32_t to = 1;
+
+#if defined(SIMD_SSSE3)
+    const __m128i table = _mm_loadu_si128((const __m128i *)tfibo);
+    const __m128i low = _mm_set1_epi8(0x0f);
+    const __m128i last = _mm_set1_epi8(15);
+    __m128i acc = _mm_set1_epi8((char)value);
+    
+    for (; at + 16 <= packed_length && to + 32 <= count; at += 16, to += 32)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *)(packed + at));
+        __m128i dh = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(in, 4), low));
+        __m128i dl = _mm_shuffle_epi8(table, _mm_and_si128(in, low));
+
+        __m128i d0 = _mm_unpacklo_epi8(dh, dl);
+        __m128i d1 = _mm_unpackhi_epi8(dh, dl);
+
+        // prefix sum in 4 steps
+        
+        d0 = _mm_add_epi8(d0, _mm_slli_si128(d0, 1));
+        d1 = _mm_add_epi8(d1, _mm_slli_si128(d1, 1));
+        d0 = _mm_add_epi8(d0, _mm_slli_si128(d0, 2));
+        d1 = _mm_add_epi8(d1, _mm_slli_si128(d1, 2));
+        d0 = _mm_add_epi8(d0, _mm_slli_si128(d0, 4));
+        d1 = _mm_add_epi8(d1, _mm_slli_si128(d1, 4));
+        d0 = _mm_add_epi8(d0, _mm_slli_si128(d0, 8));
+        d1 = _mm_add_epi8(d1, _mm_slli_si128(d1, 8));
+
+        d0 = _mm_add_epi8(d0, acc);
+        acc = _mm_shuffle_epi8(d0, last);
+        d1 = _mm_add_epi8(d1, acc);
+        acc = _mm_shuffle_epi8(d1, last);
+
+        _mm_storeu_si128((__m128i *)(out + to), d0);
+        _mm_storeu_si128((__m128i *)(out + to + 16), d1);
+    }
+    
+    value = (uint8_t)_mm_cvtsi128_si32(acc);
+#elif defined(SIMD_NEON)
+    const int8x16_t table = vld1q_s8(tfibo);
+    const uint8x16_t zero = vdupq_n_u8(0);
+    uint8x16_t acc = vdupq_n_u8(value);
+
+    for (; at + 16 <= packed_length && to + 32 <= count; at += 16, to += 32)
+    {
+        uint8x16_t in = vld1q_u8(packed + at);
+        uint8x16_t dh = vreinterpretq_u8_s8(vqtbl1q_s8(table, vshrq_n_u8(in, 4)));
+        uint8x16_t dl = vreinterpretq_u8_s8(vqtbl1q_s8(table, vandq_u8(in, vdupq_n_u8(0x0f))));
+
+        uint8x16_t d0 = vzip1q_u8(dh, dl);
+        uint8x16_t d1 = vzip2q_u8(dh, dl);
+
+        // prefix sum in 4 steps
+
+        d0 = vaddq_u8(d0, vextq_u8(zero, d0, 15));
+        d1 = vaddq_u8(d1, vextq_u8(zero, d1, 15));
+        d0 = vaddq_u8(d0, vextq_u8(zero, d0, 14));
+        d1 = vaddq_u8(d1, vextq_u8(zero, d1, 14));
+        d0 = vaddq_u8(d0, vextq_u8(zero, d0, 12));
+        d1 = vaddq_u8(d1, vextq_u8(zero, d1, 12));
+        d0 = vaddq_u8(d0, vextq_u8(zero, d0, 8));
+        d1 = vaddq_u8(d1, vextq_u8(zero, d1, 8));
+
+        d0 = vaddq_u8(d0, acc);
+        acc = vdupq_laneq_u8(d0, 15);
+        d1 = vaddq_u8(d1, acc);
+        acc = vdupq_laneq_u8(d1, 15);
+
+        vst1q_u8(out + to, d0);
+        vst1q_u8(out + to + 16, d1);
+    }
+
+    value = vgetq_lane_u8(acc, 0);
+#endif
+
+    for (; to < count; at++)
+    {
+        out[to++] = (value += tfibo[packed[at] >> 4]);
+        if (to < count)
+            out[to++] = (value += tfibo[packed[at] & 0xf]);
+    }
+
+    // last two values are always silence, so is anything past the packed data
+    
+    for (uint32_t i = std::max(1u, std::min(count, out_length - std::min(out_length, 2u))); i < out_length; i++)
+    {
+        out[i] = 0x80;
+    }
+
+    return out_length;
+}
+
+bool audio::is_signed(const uint8_t *data, uint32_t length)
+{
+    uint32_t high = 0;
+    uint32_t b = 0;
+
+#if defined(SIMD_SSE2)
+    // compare against zero as signed bytes, every negative byte adds -1 to counter lane
+    
+    const __m128i zero = _mm_setzero_si128();
+    
+    while (b + 16 <= length)
+    {
+        __m128i sum = zero;
+        uint32_t end = std::min(length & ~15u, b + 255 * 16);
+        
+        for (; b < end; b += 16)
+        {
+            __m128i in = _mm_loadu_si128((const __m128i *)(data + b));
+            sum = _mm_sub_epi8(sum, _mm_cmplt_epi8(in, zero));
+        }
+        
+        __m128i sad = _mm_sad_epu8(sum, zero);
+        high += _mm_cvtsi128_si32(sad) + _mm_extract_epi16(sad, 4);
+    }
+#elif defined(SIMD_NEON)
+    while (b + 16 <= length)
+    {
+        uint8x16_t sum = vdupq_n_u8(0);
+        uint32_t end = std::min(length & ~15u, b + 255 * 16);
+
+        for (; b < end; b += 16)
+        {
+            uint8x16_t in = vld1q_u8(data + b);
+            sum = vsubq_u8(sum, vcltzq_s8(vreinterpretq_s8_u8(in)));
+        }
+
+        high += vaddlvq_u8(sum);
+    }
+#endif
+
+    for (; b < length; b++)
+    {
+        high += data[b] >> 7;
+    }
+    
+    return high > length - high;
+}
+
+void audio::flip_sign(uint8_t *data, uint32_t length)
+{
+    uint32_t b = 0;
+    
+#if defined(SIMD_SSE2)
+    const __m128i sign = _mm_set1_epi8((char)0x80);
+    for (; b + 16 <= length; b += 16)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *)(data + b));
+        _mm_storeu_si128((__m128i *)(data + b), _mm_xor_si128(in, sign));
+    }
+#elif defined(SIMD_NEON)
+    const uint8x16_t sign = vdupq_n_u8(0x80);
+    for (; b + 16 <= length; b += 16)
+    {
+        vst1q_u8(data + b, veorq_u8(vld1q_u8(data + b), sign));
+    }
+#endif
+    
+    for (; b < length; b++)
+    {
+        data[b] ^= 0x80;
+    }
+}
+
+// taps per phase for unity or higher output rate, multiple of 4
+const int resample_taps = 16;
+const int resample_max_taps = 512;
+
+static float dot(const float *a, const float *b, int taps)
+{
+#if defined(SIMD_SSE2)
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < taps; k += 4)
+    {
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k)));
+    }
+    
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+#elif defined(SIMD_NEON)
+    float32x4_t sum = vdupq_n_f32(0);
+    for (int k = 0; k < taps; k += 4)
+    {
+        sum = vfmaq_f32(sum, vld1q_f32(a + k), vld1q_f32(b + k));
+    }
+    
+    return vaddvq_f32(sum);
+#else
+    float sum = 0;
+    for (int k = 0; k < taps; k++)
+    {
+        sum += a[k] * b[k];
+    }
+    
+    return sum;
+#endif
+}
+
+void audio::resample(const uint8_t *data, uint32_t length, bool is_signed, int in_rate, int out_rate, std::vector<int16_t>& out)
+{
+    out.clear();
+    if (length == 0 || in_rate <= 0 || out_rate <= 0)
+        return;
+    
+    // upsample by up, low pass filter, downsample by down
+    
+    int g = std::gcd(in_rate, out_rate);
+    int up = out_rate / g;
+    int down = in_rate / g;
+
+    // NOTE: cut off follows output nyquist when downsampling, so filter has to span that many
+    // more input samples, a fixed length would leave the stop band leaking (aliasing)
+    
+    int taps = (int)std::min<int64_t>(resample_max_taps, (int64_t)resample_taps * ((down + up - 1) / up));
+    
+    // windowed sinc prototype (cut off a bit under lower nyquist), stored per phase in reverse order
+    
+    int n = up * taps;
+    double fc = 0.45 / std::max(up, down);
+    std::vector<float> coefs(n);
+    
+    for (int p = 0; p < up; p++)
+    {
+        double sum = 0;
+        for (int k = 0; k < taps; k++)
+        {
+            int j = p + (taps - 1 - k) * up;
+            double t = j - (n - 1) / 2.0;
+            double sinc = t == 0 ? 1.0 : sin(2 * M_PI * fc * t) / (2 * M_PI * fc * t);
+            double window = 0.42 - 0.5 * cos(2 * M_PI * (j + 0.5) / n) + 0.08 * cos(4 * M_PI * (j + 0.5) / n);
+            coefs[p * taps + k] = sinc * window;
+            sum += sinc * window;
+        }
+        
+        // unity gain for every phase
+        for (int k = 0; k < taps; k++)
+        {
+            coefs[p * taps + k] /= sum;
+        }
+    }
+
+    // widen to float (signed -> unsigned conversion is done here as well), zero padded for filter
+    
+    std::vector<float> input(length + taps * 2, 0.0f);
+    uint8_t sign = is_signed ? 0x00 : 0x80;
+    for (uint32_t b = 0; b < length; b++)
+    {
+        input[taps + b] = (int8_t)(data[b] ^ sign) * 256.0f;
+    }
+    
+    uint64_t count = ((uint64_t)length * up + down - 1) / down;
+    out.resize(count);
+
+    for (uint64_t o = 0; o < count; o++)
+    {
+        uint64_t pos = o * down;
+        uint64_t at = pos / up;
+        int phase = (int)(pos % up);
+        
+        // window ends half filter length after current input sample
+        float v = dot(&coefs[phase * taps], &input[at + taps / 2 + 1], taps);
+        out[o] = (int16_t)std::clamp(lrintf(v), -32768l, 32767l);
+    }
+}
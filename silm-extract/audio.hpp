@@ -0,0 +1,31 @@
+//
+//  audio.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef audio_hpp
+#define audio_hpp
+
+#include <stdint.h>
+#include <vector>
+
+namespace audio {
+
+    // Decodes fibonacci delta packed sample (1 byte start value followed by 4 bit deltas)
+    // straight into unsigned 8 bit PCM. Every byte of out is written, output the packed data
+    // doesn't cover is silence. Returns out_length.
+    uint32_t decode_fibonacci(const uint8_t *packed, uint32_t packed_length, uint8_t *out, uint32_t out_length);
+
+    // Guess if 8 bit sample is signed (more than half of values have high bit set).
+    bool is_signed(const uint8_t *data, uint32_t length);
+
+    // In place signed <-> unsigned 8 bit conversion.
+    void flip_sign(uint8_t *data, uint32_t length);
+
+    // Converts 8 bit sample to 16 bit PCM at out_rate using polyphase FIR filter.
+    void resample(const uint8_t *data, uint32_t length, bool is_signed, int in_rate, int out_rate, std::vector<int16_t>& out);
+}
+
+#endif /* audio_hpp */
@@ -0,0 +1,257 @@
+//
+//  blit.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "blit.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(SIMD_SSE2)
+
+static inline __m128i reverse16(__m128i v)
+{
+#if defined(SIMD_SSSE3)
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+#else
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+#endif
+}
+
+static inline __m128i load16(const uint8_t *src, int x, bool flip)
+{
+    return flip ? reverse16(_mm_loadu_si128((const __m128i *)(src - x - 15))) : _mm_loadu_si128((const __m128i *)(src + x));
+}
+
+#elif defined(SIMD_NEON)
+
+static inline uint8x16_t load16(const uint8_t *src, int x, bool flip)
+{
+    if (flip)
+    {
+        uint8x16_t v = vrev64q_u8(vld1q_u8(src - x - 15));
+        return vextq_u8(v, v, 8);
+    }
+    
+    return vld1q_u8(src + x);
+}
+
+#endif
+
+void blit::row8(const uint8_t *src, uint8_t *dst, int count, int clear, bool flip)
+{
+    int x = 0;
+    bool keyed = clear >= 0 && clear <= 0xff;
+    
+#if defined(SIMD_SSE2)
+    const __m128i key = _mm_set1_epi8((char)clear);
+    for (; x + 16 <= count; x += 16)
+    {
+        __m128i c = load16(src, x, flip);
+        if (keyed)
+        {
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + x));
+            __m128i m = _mm_cmpeq_epi8(c, key);
+            c = _mm_or_si128(_mm_and_si128(m, d), _mm_andnot_si128(m, c));
+        }
+        
+        _mm_storeu_si128((__m128i *)(dst + x), c);
+    }
+#elif defined(SIMD_NEON)
+    const uint8x16_t key = vdupq_n_u8((uint8_t)clear);
+    for (; x + 16 <= count; x += 16)
+    {
+        uint8x16_t c = load16(src, x, flip);
+        if (keyed)
+        {
+            c = vbslq_u8(vceqq_u8(c, key), vld1q_u8(dst + x), c);
+        }
+        
+        vst1q_u8(dst + x, c);
+    }
+#endif
+    
+    for (; x < count; x++)
+    {
+        uint8_t c = flip ? src[-x] : src[x];
+        if (keyed == false || c != clear)
+            dst[x] = c;
+    }
+}
+
+void blit::row32(const uint8_t *src, uint32_t *dst, int count, int clear, bool flip, const uint32_t *colors)
+{
+    int x = 0;
+    bool keyed = clear >= 0 && clear <= 0xff;
+    
+    // NOTE: palette lookup stays scalar (no byte gather), transparency test and masked stores are vectorized
+    
+#if defined(SIMD_SSE2)
+    const __m128i key = _mm_set1_epi8(keyed ? (char)clear : 0);
+    alignas(16) uint8_t index[16];
+    alignas(16) uint32_t pixels[16];
+    for (; x + 16 <= count; x += 16)
+    {
+        __m128i c = load16(src, x, flip);
+        __m128i m = keyed ? _mm_cmpeq_epi8(c, key) : _mm_setzero_si128();
+        
+        int skip = _mm_movemask_epi8(m);
+        if (skip == 0xffff)
+            continue;
+        
+        _mm_store_si128((__m128i *)index, c);
+        for (int i = 0; i < 16; i++)
+            pixels[i] = colors[index[i]];
+        
+        __m128i lo = _mm_unpacklo_epi8(m, m);
+        __m128i hi = _mm_unpackhi_epi8(m, m);
+        __m128i mask[4] = { _mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo), _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi) };
+        
+        for (int i = 0; i < 4; i++)
+        {
+            __m128i p = _mm_load_si128((const __m128i *)(pixels + i * 4));
+            if (skip)
+            {
+                __m128i d = _mm_loadu_si128((const __m128i *)(dst + x + i * 4));
+                p = _mm_or_si128(_mm_and_si128(mask[i], d), _mm_andnot_si128(mask[i], p));
+            }
+            
+            _mm_storeu_si128((__m128i *)(dst + x + i * 4), p);
+        }
+    }
+#elif defined(SIMD_NEON)
+    const uint8x16_t key = vdupq_n_u8(keyed ? (uint8_t)clear : 0);
+    alignas(16) uint8_t index[16];
+    alignas(16) uint32_t pixels[16];
+    for (; x + 16 <= count; x += 16)
+    {
+        uint8x16_t c = load16(src, x, flip);
+        uint8x16_t m = keyed ? vceqq_u8(c, key) : vdupq_n_u8(0);
+        
+        if (vminvq_u8(m) == 0xff)
+            continue;
+        
+        vst1q_u8(index, c);
+        for (int i = 0; i < 16; i++)
+            pixels[i] = colors[index[i]];
+        
+        uint16x8_t lo = vreinterpretq_u16_u8(vzip1q_u8(m, m));
+        uint16x8_t hi = vreinterpretq_u16_u8(vzip2q_u8(m, m));
+        uint32x4_t mask[4] = {
+            vreinterpretq_u32_u16(vzip1q_u16(lo, lo)), vreinterpretq_u32_u16(vzip2q_u16(lo, lo)),
+            vreinterpretq_u32_u16(vzip1q_u16(hi, hi)), vreinterpretq_u32_u16(vzip2q_u16(hi, hi))
+        };
+        
+        for (int i = 0; i < 4; i++)
+        {
+            uint32x4_t p = vld1q_u32(pixels + i * 4);
+            vst1q_u32(dst + x + i * 4, vbslq_u32(mask[i], vld1q_u32(dst + x + i * 4), p));
+        }
+    }
+#endif
+    
+    for (; x < count; x++)
+    {
+        uint8_t c = flip ? src[-x] : src[x];
+        if (keyed == false || c != clear)
+            dst[x] = colors[c];
+    }
+}
+
+void blit::fill32(uint32_t *dst, int count, uint32_t color)
+{
+    std::fill(dst, dst + count, color);
+}
+
+bool blit::diff(const uint8_t *a, const uint8_t *b, int count, int& first, int& last)
+{
+    int x = 0;
+    int end = count;
+    
+#if defined(SIMD_SSE2)
+    for (; x + 16 <= end; x += 16)
+    {
+        int same = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + x)), _mm_loadu_si128((const __m128i *)(b + x))));
+        if (same != 0xffff)
+        {
+            x += __builtin_ctz(~same);
+            break;
+        }
+    }
+    
+    if (x + 16 > end)
+    {
+        for (; x < end && a[x] == b[x]; x++);
+    }
+    
+    if (x == end)
+        return false;
+    
+    first = x;
+    
+    for (; end - 16 > x; end -= 16)
+    {
+        int same = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + end - 16)), _mm_loadu_si128((const __m128i *)(b + end - 16))));
+        if (same != 0xffff)
+        {
+            end -= __builtin_clz(~(unsigned)same << 16);
+            break;
+        }
+    }
+#elif defined(SIMD_NEON)
+    for (; x + 16 <= end && vminvq_u8(vceqq_u8(vld1q_u8(a + x), vld1q_u8(b + x))) == 0xff; x += 16);
+    for (; x < end && a[x] == b[x]; x++);
+    
+    if (x == end)
+        return false;
+    
+    first = x;
+    
+    for (; end - 16 > x && vminvq_u8(vceqq_u8(vld1q_u8(a + end - 16), vld1q_u8(b + end - 16))) == 0xff; end -= 16);
+#else
+    for (; x < end && a[x] == b[x]; x++);
+    
+    if (x == end)
+        return false;
+    
+    first = x;
+#endif
+    
+    for (; a[end - 1] == b[end - 1]; end--);
+    last = end - 1;
+    return true;
+}
+
+void blit::pack(const uint8_t *src, uint8_t *dst, int count, int bits, const uint8_t *lut)
+{
+    int per_byte = 8 / bits;
+    uint8_t mask = (1 << bits) - 1;
+    
+    for (int x = 0; x < count; x += per_byte)
+    {
+        uint8_t b = 0;
+        for (int p = 0; p < per_byte; p++)
+        {
+            b <<= bits;
+            if (x + p < count)
+                b |= lut[src[x + p]] & mask;
+        }
+        
+        *dst++ = b;
+    }
+}
+
+void blit::expand_palette(const uint8_t *palette, uint32_t *colors)
+{
+    for (int c = 0; c < 256; c++)
+    {
+        uint8_t rgba[4] = { palette[c * 3 + 0], palette[c * 3 + 1], palette[c * 3 + 2], 0xff };
+        memcpy(&colors[c], rgba, 4);
+    }
+}
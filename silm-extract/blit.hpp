@@ -0,0 +1,33 @@
+//
+//  blit.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef blit_hpp
+#define blit_hpp
+
+#include <stdint.h>
+
+namespace blit {
+
+    // Row copies for composites. Pixels equal to clear are skipped (clear outside 0 - 255 copies everything).
+    // With flip set src points to the rightmost pixel and is read right to left.
+    
+    void row8(const uint8_t *src, uint8_t *dst, int count, int clear, bool flip);
+    void row32(const uint8_t *src, uint32_t *dst, int count, int clear, bool flip, const uint32_t *colors);
+
+    void fill32(uint32_t *dst, int count, uint32_t color);
+
+    // first and last differing byte of two rows, false if rows are equal
+    bool diff(const uint8_t *a, const uint8_t *b, int count, int& first, int& last);
+
+    // 8 bit pixels (mapped through lut) to 1, 2 or 4 bits per pixel, leftmost pixel in high bits
+    void pack(const uint8_t *src, uint8_t *dst, int count, int bits, const uint8_t *lut);
+
+    // 256 rgb triplets to opaque RGBA pixels (byte order R, G, B, A)
+    void expand_palette(const uint8_t *palette, uint32_t *colors);
+}
+
+#endif /* blit_hpp */
@@ -0,0 +1,155 @@
+//
+//  decode.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "decode.hpp"
+#include "simd.hpp"
+
+#include <vector>
+
+using namespace decode;
+
+// word interleaved bitplanes, 16 pixels per group of words (planes + padding)
+// mask turns any set pixel into white (2 bit mac sprites are saved as mono)
+
+template <int planes, int words, bool mask>
+static void planar(const uint8_t *src, uint8_t *dst, int pixels)
+{
+    for (int b = 0; b < pixels; b += 16, src += words * 2, dst += 16)
+    {
+        for (int half = 0; half < 2; half++)
+        {
+            uint8_t bytes[planes];
+            for (int p = 0; p < planes; p++)
+                bytes[p] = src[p * 2 + half];
+            
+            for (int c = 0; c < 8; c++)
+            {
+                uint8_t value = 0;
+                for (int p = 0; p < planes; p++)
+                    value |= ((bytes[p] >> (7 - c)) & 1) << p;
+                
+                dst[half * 8 + c] = mask ? (value ? 255 : 0) : value;
+            }
+        }
+    }
+}
+
+static void chunky(const uint8_t *src, uint8_t *dst, int pixels)
+{
+    chunky4(src, dst, pixels, 0);
+}
+
+// 0x0RGB words, 3 (ST) or 4 (STE / Amiga) bits per component
+
+template <int shift>
+static void palette16(const uint8_t *src, uint8_t *dst)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        dst[i * 3 + 0] = (src[i * 2 + 0] & 0b00001111) << shift;
+        dst[i * 3 + 1] = (src[i * 2 + 1] >> 4) << shift;
+        dst[i * 3 + 2] = (src[i * 2 + 1] & 0b00001111) << shift;
+    }
+}
+
+template <bool little_endian>
+static void read_draw_calls(const uint8_t *src, int count, DrawCall *calls)
+{
+    std::vector<uint16_t> words(count * 4);
+    byte_order<little_endian>::read2b(src, words.data(), words.size());
+    
+    for (int b = 0; b < count; b++)
+    {
+        const uint16_t *w = &words[b * 4];
+        calls[b].cmd = w[0] >> 8;
+        calls[b].index = w[0] & 0xff;
+        calls[b].x = w[1];
+        calls[b].order = w[2];
+        calls[b].y = w[3];
+    }
+}
+
+alis_platform decode::platform_for_ext(const std::string& ext)
+{
+    if (ext == "ao")
+        return atari;
+    if (ext == "fo")
+        return falcon;
+    if (ext == "co")
+        return amiga;
+    if (ext == "io")
+        return aga;
+    if (ext == "mo")
+        return mac;
+    
+    return dos;
+}
+
+Codec decode::codec_for(alis_platform platform, bool little_endian, int8_t type)
+{
+    Codec c;
+    c.platform = platform;
+    
+    if (platform == mac)
+    {
+        // 2 bit
+        c.bitmap_type = data_type::image2;
+        c.bitmap_ratio = 4;
+        c.bitmap = planar<2, 2, true>;
+    }
+    else if (platform == atari && (type & 1) == 0)
+    {
+        // 3 bit
+        c.bitmap_type = data_type::image2;
+        c.bitmap_ratio = 2;
+        c.bitmap = planar<3, 4, false>;
+    }
+    else
+    {
+        c.bitmap_type = data_type::image4ST;
+        c.bitmap_ratio = 2;
+        c.bitmap = chunky;
+    }
+
+    c.palette4 = platform == amiga ? palette16<4> : palette16<5>;
+    c.draw_calls = little_endian ? read_draw_calls<true> : read_draw_calls<false>;
+    return c;
+}
+
+void decode::chunky4(const uint8_t *src, uint8_t *dst, int pixels, uint8_t base)
+{
+    int x = 0;
+    
+#if defined(SIMD_SSE2)
+    const __m128i low = _mm_set1_epi8(0x0f);
+    const __m128i add = _mm_set1_epi8((char)base);
+    for (; x + 32 <= pixels; x += 32, src += 16, dst += 32)
+    {
+        __m128i in = _mm_loadu_si128((const __m128i *)src);
+        __m128i a = _mm_and_si128(_mm_srli_epi16(in, 4), low);
+        __m128i b = _mm_and_si128(in, low);
+        _mm_storeu_si128((__m128i *)dst, _mm_add_epi8(_mm_unpacklo_epi8(a, b), add));
+        _mm_storeu_si128((__m128i *)(dst + 16), _mm_add_epi8(_mm_unpackhi_epi8(a, b), add));
+    }
+#elif defined(SIMD_NEON)
+    const uint8x16_t add = vdupq_n_u8(base);
+    for (; x + 32 <= pixels; x += 32, src += 16, dst += 32)
+    {
+        uint8x16_t in = vld1q_u8(src);
+        uint8x16_t a = vshrq_n_u8(in, 4);
+        uint8x16_t b = vandq_u8(in, vdupq_n_u8(0x0f));
+        vst1q_u8(dst, vaddq_u8(vzip1q_u8(a, b), add));
+        vst1q_u8(dst + 16, vaddq_u8(vzip2q_u8(a, b), add));
+    }
+#endif
+    
+    for (; x + 2 <= pixels; x += 2, src++)
+    {
+        *dst++ = base + (*src >> 4);
+        *dst++ = base + (*src & 0b00001111);
+    }
+}
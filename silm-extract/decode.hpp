@@ -0,0 +1,91 @@
+//
+//  decode.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef decode_hpp
+#define decode_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "extractor.hpp"
+
+namespace decode {
+
+    // byte order is known per script, so readers are resolved at compile time
+    
+    template <bool little_endian>
+    struct byte_order {
+        
+        static inline uint16_t read2b(const uint8_t *p)
+        {
+            uint16_t v;
+            memcpy(&v, p, sizeof(v));
+            return little_endian == (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ? v : __builtin_bswap16(v);
+        }
+        
+        static inline uint32_t read4b(const uint8_t *p)
+        {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return little_endian == (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ? v : __builtin_bswap32(v);
+        }
+        
+        // bulk read, written as simple loop so compiler can swap many words at once
+        static inline void read2b(const uint8_t *p, uint16_t *out, size_t count)
+        {
+            memcpy(out, p, count * sizeof(uint16_t));
+            if (little_endian != (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__))
+            {
+                for (size_t i = 0; i < count; i++)
+                    out[i] = __builtin_bswap16(out[i]);
+            }
+        }
+    };
+    
+    // Read only view of script data. Structure size is checked once (seek / has),
+    // following reads are unchecked.
+    
+    template <bool little_endian>
+    class cursor {
+        
+    public:
+        
+        typedef byte_order<little_endian> order;
+        
+        cursor(const uint8_t *data, uint32_t size) { _data = data; _size = size; _at = 0; }
+        
+        // moves to position, returns true if n bytes are available there
+        bool seek(uint32_t at, uint32_t n = 0) { _at = at; return has(n); }
+        bool has(uint64_t n) const { return _at <= _size && n <= _size - _at; }
+        
+        uint32_t position() const { return _at; }
+        uint32_t remaining() const { return _at <= _size ? _size - _at : 0; }
+        const uint8_t *ptr() const { return _data + _at; }
+        
+        void skip(uint32_t n) { _at += n; }
+        
+        uint8_t read1b() { return _data[_at++]; }
+        uint16_t read2b() { uint16_t v = order::read2b(_data + _at); _at += 2; return v; }
+        uint32_t read4b() { uint32_t v = order::read4b(_data + _at); _at += 4; return v; }
+        void read2b(uint16_t *out, size_t count) { order::read2b(_data + _at, out, count); _at += count * 2; }
+        
+    private:
+        
+        const uint8_t *_data;
+        uint32_t _size;
+        uint32_t _at;
+    };
+
+    alis_platform platform_for_ext(const std::string& ext);
+    Codec codec_for(alis_platform platform, bool little_endian, int8_t type);
+
+    // 4 bit chunky pixels (high nibble first) with palette offset
+    void chunky4(const uint8_t *src, uint8_t *dst, int pixels, uint8_t base = 0);
+}
+
+#endif /* decode_hpp */
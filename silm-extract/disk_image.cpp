@@ -0,0 +1,297 @@
+//
+//  disk_image.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "disk_image.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+// NOTE: ADF blocks are 512 bytes, all values big endian. Header blocks (root, directory,
+// file) keep a 72 entry hash table or data block list at 24, the name at 432.
+
+#define ADF_BLOCK           512
+#define ADF_TABLE           72
+#define ADF_T_HEADER        2
+#define ADF_T_LIST          16
+#define ADF_T_DATA          8
+#define ADF_ST_ROOT         1
+#define ADF_ST_USERDIR      2
+#define ADF_ST_FILE         -3
+
+static uint32_t be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint16_t le16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+disk_image::disk_image()
+{
+    _data = NULL;
+    _size = 0;
+    _ffs = false;
+}
+
+bool disk_image::is_disk_image(const std::filesystem::path& path)
+{
+    std::string e = path.extension().string();
+    std::transform(e.begin(), e.end(), e.begin(), ::tolower);
+    return e == ".adf" || e == ".st";
+}
+
+bool disk_image::open(const std::filesystem::path& path)
+{
+    if (_map.open(path.string()) == false || _map.size() < ADF_BLOCK * 4)
+        return false;
+    
+    _data = _map.data();
+    _size = _map.size();
+    
+    if (memcmp(_data, "DOS", 3) == 0 && _data[3] < 8)
+        return open_adf();
+    
+    return open_fat12();
+}
+
+bool disk_image::read(const file& f, std::vector<uint8_t>& out) const
+{
+    return _format == adf ? read_adf(f, out) : read_fat12(f, out);
+}
+
+const uint8_t *disk_image::block(uint32_t index) const
+{
+    if (index == 0 || (size_t)(index + 1) * ADF_BLOCK > _size)
+        return NULL;
+    
+    return _data + (size_t)index * ADF_BLOCK;
+}
+
+bool disk_image::open_adf()
+{
+    _format = adf;
+    _ffs = _data[3] & 1;
+    
+    // root sits in the middle, 880 on DD and 1760 on HD disks
+    
+    uint32_t root = (uint32_t)(_size / ADF_BLOCK / 2);
+    const uint8_t *b = block(root);
+    if (b == NULL || be32(b) != ADF_T_HEADER || (int32_t)be32(b + ADF_BLOCK - 4) != ADF_ST_ROOT)
+        return false;
+    
+    std::vector<bool> seen(_size / ADF_BLOCK);
+    list_adf(root, "", seen);
+    return true;
+}
+
+void disk_image::list_adf(uint32_t dir, const std::string& prefix, std::vector<bool>& seen)
+{
+    const uint8_t *d = block(dir);
+    
+    for (int h = 0; h < ADF_TABLE; h++)
+    {
+        uint32_t key = be32(d + 24 + h * 4);
+        
+        // every header block is visited once, so broken images can not loop
+        
+        while (key)
+        {
+            const uint8_t *b = block(key);
+            if (b == NULL || seen[key] || be32(b) != ADF_T_HEADER)
+                break;
+            
+            seen[key] = true;
+            
+            int length = std::min<int>(b[432], 30);
+            std::string name = prefix + std::string((const char *)b + 433, length);
+            int32_t sec_type = (int32_t)be32(b + ADF_BLOCK - 4);
+            
+            if (sec_type == ADF_ST_FILE)
+            {
+                _files.push_back({ name, be32(b + ADF_BLOCK - 188), key });
+            }
+            else if (sec_type == ADF_ST_USERDIR)
+            {
+                list_adf(key, name + "/", seen);
+            }
+            
+            key = be32(b + ADF_BLOCK - 16);
+        }
+    }
+}
+
+bool disk_image::read_adf(const file& f, std::vector<uint8_t>& out) const
+{
+    out.clear();
+    if (f.size > _size)
+        return false;
+    
+    out.reserve(f.size);
+    
+    // data blocks are listed backwards from the end of the table, in the
+    // file header and then in extension blocks
+    
+    const uint8_t *header = block(f.first);
+    const int payload = _ffs ? ADF_BLOCK : ADF_BLOCK - 24;
+    
+    for (int ext = 0; header && out.size() < f.size && ext < 4096; ext++)
+    {
+        uint32_t count = std::min<uint32_t>(be32(header + 8), ADF_TABLE);
+        for (uint32_t i = 0; i < count && out.size() < f.size; i++)
+        {
+            const uint8_t *b = block(be32(header + 24 + (ADF_TABLE - 1 - i) * 4));
+            if (b == NULL)
+                return false;
+            
+            size_t n = std::min<size_t>(payload, f.size - out.size());
+            if (_ffs)
+            {
+                out.insert(out.end(), b, b + n);
+            }
+            else
+            {
+                if (be32(b) != ADF_T_DATA)
+                    return false;
+                
+                n = std::min<size_t>(n, be32(b + 12));
+                out.insert(out.end(), b + 24, b + 24 + n);
+            }
+        }
+        
+        header = block(be32(header + ADF_BLOCK - 8));
+        if (header && be32(header) != ADF_T_LIST)
+            return false;
+    }
+    
+    return out.size() == f.size;
+}
+
+bool disk_image::open_fat12()
+{
+    _format = fat12;
+    
+    // NOTE: ST boot sectors have no 0x55aa signature, the BPB is checked instead
+    
+    const uint8_t *bpb = _data;
+    _sector = le16(bpb + 0x0b);
+    uint32_t per_cluster = bpb[0x0d];
+    uint32_t reserved = le16(bpb + 0x0e);
+    uint32_t fats = bpb[0x10];
+    uint32_t root_entries = le16(bpb + 0x11);
+    uint32_t sectors = le16(bpb + 0x13);
+    uint32_t per_fat = le16(bpb + 0x16);
+    
+    if (_sector < 128 || _sector > 4096 || (_sector & (_sector - 1)) || per_cluster == 0 || (per_cluster & (per_cluster - 1))
+        || reserved == 0 || fats == 0 || fats > 2 || root_entries == 0 || per_fat == 0)
+        return false;
+    
+    if (sectors == 0 || (size_t)sectors * _sector > _size)
+        sectors = (uint32_t)(_size / _sector);
+    
+    _cluster = per_cluster * _sector;
+    _fat = reserved * _sector;
+    
+    uint32_t root = (reserved + fats * per_fat) * _sector;
+    _data_area = root + (root_entries * 32 + _sector - 1) / _sector * _sector;
+    if (_data_area >= _size)
+        return false;
+    
+    _clusters = std::min<uint32_t>((uint32_t)((_size - _data_area) / _cluster) + 2, per_fat * _sector * 2 / 3);
+    
+    std::vector<bool> seen(_clusters);
+    list_fat12(root, root_entries, 0, "", seen);
+    return true;
+}
+
+uint32_t disk_image::next_cluster(uint32_t cluster) const
+{
+    const uint8_t *p = _data + _fat + cluster * 3 / 2;
+    return cluster & 1 ? (p[0] >> 4 | p[1] << 4) : (p[0] | (p[1] & 0x0f) << 8);
+}
+
+void disk_image::list_fat12(uint32_t offset, uint32_t entries, uint32_t cluster, const std::string& prefix, std::vector<bool>& seen)
+{
+    // root directory is one fixed area, sub directories are cluster chains,
+    // every cluster is visited once, so broken images can not loop
+    
+    uint32_t per_cluster = _cluster / 32;
+    for (;;)
+    {
+        if (cluster)
+        {
+            if (cluster < 2 || cluster >= _clusters || seen[cluster])
+                return;
+            
+            seen[cluster] = true;
+            offset = _data_area + (cluster - 2) * _cluster;
+            entries = per_cluster;
+        }
+        
+        for (uint32_t i = 0; i < entries && offset + i * 32 + 32 <= _size; i++)
+        {
+            const uint8_t *e = _data + offset + i * 32;
+            if (e[0] == 0x00)
+                return;
+            
+            uint8_t attr = e[0x0b];
+            if (e[0] == 0xe5 || e[0] == '.' || (attr & 0x08))
+                continue;
+            
+            std::string name((const char *)e, 8);
+            name.erase(name.find_last_not_of(' ') + 1);
+            
+            std::string ext((const char *)e + 8, 3);
+            ext.erase(ext.find_last_not_of(' ') + 1);
+            
+            if (ext.size())
+                name += "." + ext;
+            
+            if (attr & 0x10)
+                list_fat12(0, 0, le16(e + 0x1a), prefix + name + "/", seen);
+            else
+                _files.push_back({ prefix + name, le32(e + 0x1c), le16(e + 0x1a) });
+        }
+        
+        if (cluster == 0)
+            return;
+        
+        cluster = next_cluster(cluster);
+    }
+}
+
+bool disk_image::read_fat12(const file& f, std::vector<uint8_t>& out) const
+{
+    out.clear();
+    if (f.size > _size)
+        return false;
+    
+    out.reserve(f.size);
+    
+    uint32_t cluster = f.first;
+    for (uint32_t steps = 0; out.size() < f.size && steps < _clusters; steps++)
+    {
+        if (cluster < 2 || cluster >= _clusters)
+            return false;
+        
+        size_t from = _data_area + (size_t)(cluster - 2) * _cluster;
+        size_t n = std::min<size_t>(_cluster, f.size - out.size());
+        if (from + n > _size)
+            return false;
+        
+        out.insert(out.end(), _data + from, _data + from + n);
+        cluster = next_cluster(cluster);
+    }
+    
+    return out.size() == f.size;
+}
@@ -0,0 +1,75 @@
+//
+//  disk_image.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef disk_image_hpp
+#define disk_image_hpp
+
+#include <filesystem>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+
+// Read only access to files of Amiga ADF (OFS / FFS) and Atari ST (FAT12) disk
+// images. The image is memory mapped, file data is gathered from its blocks.
+
+class disk_image {
+    
+public:
+    
+    struct file {
+        
+        std::string name;       // path inside image, '/' separated
+        uint32_t size;
+        uint32_t first;         // file header block (ADF) or first cluster (ST)
+    };
+    
+    disk_image();
+    
+    static bool is_disk_image(const std::filesystem::path& path);
+    
+    bool open(const std::filesystem::path& path);
+    
+    const std::vector<file>& files() const { return _files; }
+    bool read(const file& f, std::vector<uint8_t>& out) const;
+    
+private:
+    
+    enum format { adf, fat12 };
+    
+    const uint8_t *block(uint32_t index) const;
+    
+    bool open_adf();
+    void list_adf(uint32_t dir, const std::string& prefix, std::vector<bool>& seen);
+    bool read_adf(const file& f, std::vector<uint8_t>& out) const;
+    
+    bool open_fat12();
+    void list_fat12(uint32_t offset, uint32_t entries, uint32_t cluster, const std::string& prefix, std::vector<bool>& seen);
+    uint32_t next_cluster(uint32_t cluster) const;
+    bool read_fat12(const file& f, std::vector<uint8_t>& out) const;
+    
+    format _format;
+    
+    utils::mapped_file _map;
+    const uint8_t *_data;
+    size_t _size;
+    
+    // ADF
+    bool _ffs;
+    
+    // FAT12
+    uint32_t _sector;
+    uint32_t _cluster;      // bytes per cluster
+    uint32_t _fat;          // offset of first FAT
+    uint32_t _data_area;
+    uint32_t _clusters;     // highest cluster number + 1
+    
+    std::vector<file> _files;
+};
+
+#endif /* disk_image_hpp */
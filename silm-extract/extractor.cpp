@@ -8,18 +8,35 @@
 #include "extractor.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <map>
+#include <memory>
 #include <set>
 #include <ranges>
+#include <unistd.h>
 
 #include <png.h>
+#include <zlib.h>
+#include "apng.hpp"
+#include "atlas.hpp"
+#include "audio.hpp"
+#include "blit.hpp"
+#include "decode.hpp"
+#include "disk_image.hpp"
+#include "fli.hpp"
+#include "phash.hpp"
+#include "png_encoder.hpp"
+#include "qoi.hpp"
+#include "scan.hpp"
 #include "utils.hpp"
+#include "watch.hpp"
 #include "wav.hpp"
+#include "zip_archive.hpp"
 
 extern "C"
 {
@@ -39,6 +56,7 @@ const char *extensions[] = { "ao", "co", "do", "fo", "io", "mo" };
 extractor::extractor(alis_platform platform)
 {
     _platform = platform;
+    _codec = decode::codec_for(_platform, false, 0);
 }
 
 extractor::extractor(const path& output, char *palette, bool force_tc, bool list_only)
@@ -53,10 +71,27 @@ extractor::extractor(const path& output, char *palette, bool force_tc, bool list
         }
     }
 
+    _platform = atari;
+    _codec = decode::codec_for(_platform, false, 0);
+    
     _out_dir = output;
     _override_pal = (uint8_t *)palette;
     _force_tc = force_tc;
     _list_only = list_only;
+    _sample_rate = 0;
+    _convert_video = false;
+    _animate = false;
+    _transparent = false;
+    _format = format_png;
+    _atlas = false;
+    _tile_size = 0;
+    _in_dir = false;
+    _phash_distance = -1;
+    _pack = false;
+    _scan = "";
+    _shard_index = 0;
+    _shard_count = 0;
+    _mem_limit = 0;
 }
 
 extractor::~extractor()
@@ -74,6 +109,73 @@ void extractor::set_out_dir(const path& output)
     _out_dir = output;
 }
 
+void extractor::set_sample_rate(int rate)
+{
+    _sample_rate = rate;
+}
+
+void extractor::set_convert_video(bool convert)
+{
+    _convert_video = convert;
+}
+
+void extractor::set_animate(bool animate)
+{
+    _animate = animate;
+}
+
+void extractor::set_transparent(bool transparent)
+{
+    _transparent = transparent;
+}
+
+void extractor::set_image_format(image_format format)
+{
+    _format = format;
+}
+
+void extractor::set_atlas(bool atlas)
+{
+    _atlas = atlas;
+}
+
+void extractor::set_tiles(int size)
+{
+    _tile_size = size;
+    _tiles = tile_set(size);
+}
+
+void extractor::set_phash(int distance)
+{
+    _phash_distance = distance;
+}
+
+void extractor::set_pack(bool pack)
+{
+    _pack = pack;
+}
+
+void extractor::set_scan(const std::string& ext)
+{
+    _scan = ext;
+}
+
+void extractor::set_shard(int index, int count)
+{
+    _shard_index = index;
+    _shard_count = count;
+}
+
+void extractor::set_mem_limit(uint64_t bytes)
+{
+    _mem_limit = bytes;
+}
+
+void extractor::set_palette_variants(const vector<PaletteVariant>& variants)
+{
+    _variants = variants;
+}
+
 bool extractor::is_script(const path& file)
 {
     string e = utils::get_file_ext(file.string());
@@ -82,7 +184,6 @@ bool extractor::is_script(const path& file)
     {
         if (v == e)
         {
-            _platform_ext = e;
             return true;
         }
     }
@@ -92,15 +193,72 @@ bool extractor::is_script(const path& file)
 
 void extractor::extract_dir(const path& dir, uint32_t type)
 {
+    _in_dir = true;
+    
+    // NOTE: sorted, so runs over the same tree (or its shards) give the same order
+    
+    vector<path> files;
     for (const auto & file : directory_iterator(dir))
     {
-        if (is_script(file.path()))
-            extract_file(file.path(), type);
+        if (is_script(file.path()) || disk_image::is_disk_image(file.path()) || zip_archive::is_zip(file.path()) || (_scan.size() && file.is_regular_file()))
+        {
+            if (in_shard(file.path().lexically_relative(dir)))
+                files.push_back(file.path());
+        }
     }
+    
+    std::sort(files.begin(), files.end());
+    for (const path& file : files)
+        extract_file(file, type);
+    
+    _in_dir = false;
+    
+    string name = (dir.has_filename() ? dir : dir.parent_path()).filename().string();
+    write_collected(_shard_count ? name + " " + shard_suffix() : name);
+}
+
+// NOTE: FNV-1a of the path relative to the input directory, the same on every machine
+
+bool extractor::in_shard(const path& relative)
+{
+    if (_shard_count == 0)
+        return true;
+    
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : relative.generic_string())
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3ull;
+    }
+    
+    return hash % _shard_count == (uint64_t)_shard_index;
+}
+
+string extractor::shard_suffix()
+{
+    return "shard " + std::to_string(_shard_index) + "-" + std::to_string(_shard_count);
 }
 
 void extractor::extract_file(const path& file, uint32_t type, vector<uint8_t *> *pal_overrides)
 {
+    if (_scan.size())
+    {
+        extract_dump(file, type);
+        return;
+    }
+    
+    if (disk_image::is_disk_image(file))
+    {
+        extract_disk(file, type);
+        return;
+    }
+    
+    if (zip_archive::is_zip(file))
+    {
+        extract_zip(file, type);
+        return;
+    }
+    
     std::string name = utils::get_file_name(file.string(), false);
     cout << name << endl;
 
@@ -112,211 +270,1006 @@ void extractor::extract_file(const path& file, uint32_t type, vector<uint8_t *>
         is.seekg (0, is.beg);
 
         cout << "Reading " << std::dec << length << " bytes... " << endl;
+        
+        if (length < 4)
+        {
+            cout << "File too short!" << endl;
+            return;
+        }
 
         char *buffer = new char [length];
         is.read(buffer, length);
         is.close();
 
-        int unpacked_size = 0;
-        uint8_t *unpacked = NULL;
+        extract_script(name, file, (uint8_t *)buffer, (int)length, type, pal_overrides, false);
+        
+        delete[] buffer;
+    }
+    
+    if (_in_dir == false)
+        write_collected(name);
+    
+    cout << endl;
+}
 
-        sPlatform *platform = pl_guess(file.string().c_str());
-        _is_little_endian = platform->is_little_endian;
+void extractor::extract_disk(const path& file, uint32_t type)
+{
+    std::string name = utils::get_file_name(file.string(), false);
+    cout << name << endl;
+    
+    disk_image disk;
+    if (disk.open(file) == false)
+    {
+        cout << "Unknown disk image!" << endl << endl;
+        return;
+    }
+    
+    // scripts of one disk or zip share tileset and hashes like a directory
+    
+    bool in_dir = _in_dir;
+    _in_dir = true;
+    
+    vector<uint8_t> data;
+    for (const disk_image::file& f : disk.files())
+    {
+        if (is_script(f.name) == false)
+            continue;
+        
+        cout << f.name << endl;
+        
+        if (disk.read(f, data) == false || data.size() < 4)
+        {
+            cout << "Broken file!" << endl << endl;
+            continue;
+        }
+        
+        cout << "Reading " << std::dec << data.size() << " bytes... " << endl;
+        
+        extract_script(path(f.name).stem().string(), f.name, data.data(), (int)data.size(), type, NULL, true);
+        cout << endl;
+    }
+    
+    _in_dir = in_dir;
+    
+    if (_in_dir == false)
+        write_collected(name);
+    
+    cout << endl;
+}
 
-        u32 magic = read4b((const uint8_t *)buffer);
-        _type = magic >> 24;
-        if (_type < 0)
+void extractor::extract_zip(const path& file, uint32_t type)
+{
+    std::string name = utils::get_file_name(file.string(), false);
+    cout << name << endl;
+    
+    zip_archive zip;
+    if (zip.open(file) == false)
+    {
+        cout << "Unknown zip archive!" << endl << endl;
+        return;
+    }
+    
+    vector<const zip_archive::member *> scripts;
+    for (const zip_archive::member& m : zip.members())
+    {
+        if (is_script(m.name))
+            scripts.push_back(&m);
+    }
+    
+    bool in_dir = _in_dir;
+    _in_dir = true;
+    
+    // NOTE: members are inflated in parallel a batch at a time, extraction state
+    // lives in the extractor, so scripts are then extracted one after another;
+    // with a memory budget a batch holds at most half of it (at least one member)
+    
+    const size_t batch = 16;
+    vector<vector<uint8_t>> data(batch);
+    vector<char> valid(batch);
+    
+    size_t count = 0;
+    for (size_t first = 0; first < scripts.size(); first += count)
+    {
+        uint64_t bytes = 0;
+        for (count = 0; count < batch && first + count < scripts.size(); count++)
         {
-            unpacked_size = unpack_script(file.string().c_str(), platform->is_little_endian, &unpacked);
-            if (unpacked_size >= 0)
+            bytes += scripts[first + count]->size;
+            if (count && _mem_limit && bytes > _mem_limit / 2)
+                break;
+        }
+        
+        utils::parallel_for(count, [&](size_t j) {
+            valid[j] = zip.read(*scripts[first + j], data[j]) && data[j].size() >= 4;
+        });
+        
+        for (size_t j = 0; j < count; j++)
+        {
+            const std::string& member = scripts[first + j]->name;
+            cout << member << endl;
+            
+            if (valid[j] == false)
             {
-                _is_packed = true;
-                
-                extract_buffer(name, unpacked, unpacked_size, type, pal_overrides);
-                free(unpacked);
+                cout << "Broken file!" << endl << endl;
+                continue;
             }
+            
+            cout << "Reading " << std::dec << data[j].size() << " bytes... " << endl;
+            
+            extract_script(path(member).stem().string(), member, data[j].data(), (int)data[j].size(), type, NULL, true);
+            cout << endl;
+            
+            vector<uint8_t>().swap(data[j]);
         }
-        else
+    }
+    
+    _in_dir = in_dir;
+    
+    if (_in_dir == false)
+        write_collected(name);
+    
+    cout << endl;
+}
+
+void extractor::watch(const path& input, uint32_t type)
+{
+    bool is_dir = std::filesystem::is_directory(input);
+    path dir = is_dir ? input : input.parent_path();
+    
+    // NOTE: outputs may land in the watched directory too, in scan mode they must not pass for dumps
+    
+    static const std::set<string> outputs = { "part", "png", "qoi", "act", "tcl", "wav", "fli", "pattern", "json", "tilemap", "pak", "txt" };
+    
+    cout << "Watching " << dir.string() << " for changes..." << endl << endl;
+    
+    watch::run(dir, [&](const path& file) {
+        
+        if (is_dir == false && file.filename() != input.filename())
+            return;
+        
+        // scripts of other shards are watched by their own runs
+        if (is_dir && in_shard(file.lexically_relative(dir)) == false)
+            return;
+        
+        if (std::filesystem::is_regular_file(file) == false)
+            return;
+        
+        string ext = utils::get_file_ext(file.string());
+        transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        
+        bool dump = _scan.size() && outputs.count(ext) == 0;
+        if (dump || is_script(file) || disk_image::is_disk_image(file) || zip_archive::is_zip(file))
         {
-            // probably not gona to work, but what the hell :-)
-            // it could only work on unpacked files
+            auto start = std::chrono::steady_clock::now();
+            extract_file(file, type);
             
-            _is_packed = false;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            cout << "Re-extracted " << file.filename().string() << " in " << std::dec << ms << " ms" << endl << endl;
+        }
+    });
+}
 
-            unpacked_size = (int)length;
-            unpacked = (uint8_t *)buffer;
+void extractor::extract_dump(const path& file, uint32_t type)
+{
+    std::string name = utils::get_file_name(file.string(), false);
+    cout << name << endl;
+    
+    std::ifstream is(file, std::ifstream::binary);
+    if (!is)
+        return;
+    
+    is.seekg (0, is.end);
+    long length = is.tellg();
+    is.seekg (0, is.beg);
+    
+    cout << "Scanning " << std::dec << length << " bytes... " << endl;
+    
+    if (length > INT_MAX)
+    {
+        cout << "File too big!" << endl << endl;
+        return;
+    }
+    
+    vector<uint8_t> data(length);
+    is.read((char *)data.data(), length);
+    is.close();
+    
+    // nothing tells the platform of a dump, it is given by script extension
+    
+    _platform = decode::platform_for_ext(_scan);
+    _is_little_endian = pl_guess(("dump." + _scan).c_str())->is_little_endian;
+    _is_packed = false;
+    _type = 0;
+    _codec = decode::codec_for(_platform, _is_little_endian, _type);
+    
+    vector<AssetTable> tables;
+    scan_tables(data.data(), (int)length, tables);
+    cout << "Found " << std::dec << tables.size() << " address blocks" << endl << endl;
+    
+    bool in_dir = _in_dir;
+    _in_dir = true;
+    
+    for (const AssetTable& t : tables)
+    {
+        char at[16];
+        snprintf(at, sizeof(at), " %.6x", t.address);
+        
+        cout << "Address block [0x" << std::hex << std::setw(6) << std::setfill('0') << t.address << "] " << (t.mod ? "snd" : "gfx") << endl;
+        cout << " containing " << std::dec << t.entries << " assets" << endl;
+        
+        // script type decides between planar and chunky bitmaps on atari, it is
+        // the first byte of script header pointing at this table, if there is one
+        
+        int header = find_header(data.data(), (int)length, t.address);
+        _type = header < 0 ? 0 : data[header];
+        _codec = decode::codec_for(_platform, _is_little_endian, _type);
+        
+        extract_assets(name + at, data.data(), (int)length, t.address, t.entries, t.mod, type, NULL);
+        cout << endl;
+    }
+    
+    _in_dir = in_dir;
+    
+    if (_in_dir == false)
+        write_collected(name);
+    
+    cout << endl;
+}
+
+// start of unpacked script whose header leads to address table (see find_assets), -1 if none
+int extractor::find_header(const uint8_t *buffer, int length, uint32_t address)
+{
+    // every read below stays under address, so address in the buffer is all that has to hold
+    if (address > (uint32_t)length)
+        return -1;
+    
+    for (int64_t start = (int64_t)address - 0x1a; start >= 0 && start + 0x10000 >= (int64_t)address; start -= 2)
+    {
+        // NOTE: location has to lie past the header, zeroed headers would match anywhere otherwise
+        
+        uint64_t location = start + read4b(buffer + start + 0x14) + 6;
+        if (location < (uint64_t)start + 0x18 || location + 0x10 > address)
+            continue;
+        
+        if (location + read4b(buffer + location) == address || location + read4b(buffer + location + 0xc) == address)
+            return (int)start;
+    }
+    
+    return -1;
+}
+
+// entries of table at address with increasing locations and sane headers, 0 if there are too few,
+// bytes tells how much of the blob the assets cover
+uint32_t extractor::check_table(const uint8_t *buffer, int length, uint32_t address, uint32_t mod, uint64_t& bytes)
+{
+    uint32_t entries = 0;
+    uint64_t last = 0;
+    bytes = 0;
+    
+    for (uint64_t position = address; position + 4 <= (uint64_t)length; position += 4)
+    {
+        uint64_t location = position + 2 + read4b(buffer + position);
+        if (location <= last || location + 4 > (uint64_t)length)
+            break;
+        
+        const uint8_t *header = buffer + location - 2;
+        int size = asset_size(header, mod);
+        if ((size <= 0 && mod + header[0] != 0xff) || location + size > (uint64_t)length)
+            break;
+        
+        last = location;
+        bytes += size;
+        entries++;
+    }
+    
+    return entries >= 4 ? entries : 0;
+}
+
+void extractor::scan_tables(const uint8_t *buffer, int length, vector<AssetTable>& tables)
+{
+    // NOTE: chunks are scanned in parallel, a table may reach into the next chunk
+    
+    const size_t chunk = 1 << 20;
+    size_t chunks = (length + chunk - 1) / chunk;
+    
+    vector<vector<AssetTable>> found(chunks);
+    utils::parallel_for(chunks, [&](size_t c) {
+        
+        vector<uint32_t> candidates;
+        scan::table_candidates(buffer, length, c * chunk, (c + 1) * chunk, _is_little_endian, candidates);
+        
+        for (uint32_t address : candidates)
+        {
+            // NOTE: sound tables mostly pass as graphics too (rectangles), the one covering more wins
+            
+            uint64_t gfx_bytes, snd_bytes;
+            uint32_t gfx = check_table(buffer, length, address, 0, gfx_bytes);
+            uint32_t snd = check_table(buffer, length, address, 0x100, snd_bytes);
+            
+            bool sound = snd > gfx || (snd == gfx && snd_bytes > gfx_bytes);
+            if (gfx || snd)
+                found[c].push_back({ address, sound ? snd : gfx, sound ? 0x100u : 0u });
+        }
+    });
+    
+    // tails of a table are tables too, only the longest one is kept
+    
+    uint64_t end = 0;
+    for (const auto& f : found)
+    {
+        for (const AssetTable& t : f)
+        {
+            if (t.address < end)
+                continue;
+            
+            tables.push_back(t);
+            end = t.address + (uint64_t)t.entries * 4;
+        }
+    }
+}
+
+void extractor::write_collected(const std::string& name)
+{
+    // NOTE: catalogs written before are read back (see write_phash)
+    
+    _writer.flush();
+    
+    if (_tile_size)
+        write_tiles(name);
+    
+    if (_pack)
+        _packer.save(_out_dir / (name + ".pak"));
+    
+    write_phash();
+    
+    _writer.flush();
+}
+
+void extractor::extract_script(const std::string& name, const path& file, uint8_t *buffer, int length, uint32_t type, vector<uint8_t *> *pal_overrides, bool in_archive)
+{
+    int unpacked_size = 0;
+    uint8_t *unpacked = NULL;
 
+    sPlatform *platform = pl_guess(file.string().c_str());
+    _is_little_endian = platform->is_little_endian;
+
+    u32 magic = read4b(buffer);
+    _type = magic >> 24;
+    
+    // everything platform or format specific is decided here, once per script
+    
+    string ext = utils::get_file_ext(file.string());
+    transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    
+    _platform = decode::platform_for_ext(ext);
+    _codec = decode::codec_for(_platform, _is_little_endian, _type);
+    if (_type < 0)
+    {
+        // NOTE: depacker only reads from files, scripts from disk images and zips are handed
+        // over as memory file (a temporary copy where the system has none)
+        
+        path source = file;
+        utils::memory_file staged;
+        if (in_archive)
+        {
+            if (staged.open(file.filename().string(), buffer, length) == false)
+            {
+                cout << "Can't stage packed script!" << endl << endl;
+                return;
+            }
+            
+            source = staged.path();
+        }
+        
+        unpacked_size = unpack_script(source.string().c_str(), platform->is_little_endian, &unpacked);
+        
+        if (unpacked_size >= 0)
+        {
+            _is_packed = true;
+            
             extract_buffer(name, unpacked, unpacked_size, type, pal_overrides);
+            free(unpacked);
         }
+    }
+    else
+    {
+        // probably not gona to work, but what the hell :-)
+        // it could only work on unpacked files
         
-        delete[] buffer;
+        _is_packed = false;
+
+        extract_buffer(name, buffer, length, type, pal_overrides);
+    }
+}
+
+void log_data(const uint8_t *p, int f, int s0, int s1, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+
+    char t0[8] = "]";
+    if (s0 > 24)
+    {
+        s0 = 24;
+        strcpy(t0, "...");
+    }
+
+    char t1[8] = "]";
+    if (s1 > 24)
+    {
+        s1 = 24;
+        strcpy(t1, "...");
+    }
+
+    s1 += s0 + f;
+    s0 += f;
+
+    if (f < s0)
+    {
+        printf("[");
+        
+        for (int i = f; i < s0; i++)
+            printf(" %.2x", p[i]);
+        
+        printf(" %s", t0);
     }
     
-    cout << endl;
+    if (s0 < s1)
+    {
+        printf("[");
+        
+        for (int i = s0; i < s1; i++)
+            printf(" %.2x", p[i]);
+        
+        printf(" %s", t1);
+    }
+
+    printf("\n");
+}
+
+void extractor::write_buffer(const std::filesystem::path& path, const Buffer& buffer)
+{
+    _writer.write(path, vector<uint8_t>(buffer.data, buffer.data + buffer.size));
+}
+
+void extractor::write_fli_frames(const std::string& name, fli_decoder& fli)
+{
+    if (fli.is_valid() == false)
+    {
+        cout << "Unknown FLI format!" << endl;
+        return;
+    }
+    
+    // NOTE: frames come out of the seek index one after another, but png compression can run in parallel
+    
+    const int batch = 64;
+    const size_t frame_size = fli.width() * fli.height();
+
+    vector<uint8_t> pixels(batch * frame_size);
+    vector<uint8_t> palettes(batch * 256 * 3);
+
+    bool more = true;
+    for (int first = 0; more; first += batch)
+    {
+        int count = 0;
+        
+        while (count < batch && (more = fli.decode_frame(first + count)))
+        {
+            memcpy(pixels.data() + count * frame_size, fli.pixels(), frame_size);
+            memcpy(palettes.data() + count * 256 * 3, fli.palette(), 256 * 3);
+            count++;
+        }
+        
+        utils::parallel_for(count, [&](size_t f) {
+            
+            char frame[16];
+            snprintf(frame, sizeof(frame), " %.4d.png", first + (int)f);
+            
+            std::filesystem::path out = _out_dir / (name + frame);
+            write_png_file(out.string().c_str(), fli.width(), fli.height(), PNG_COLOR_TYPE_PALETTE, 8, pixels.data() + f * frame_size, palettes.data() + f * 256 * 3);
+        });
+    }
+}
+
+// NOTE: indexed images get the smallest bit depth holding their colors. Palette is cut
+// after the highest used index, used colors are only renumbered if that saves bits.
+
+static int index_colors(const uint8_t *data, int count, uint8_t *lut, uint8_t *order, bool *used)
+{
+    auto depth_for = [](int colors) { return colors <= 2 ? 1 : colors <= 4 ? 2 : colors <= 16 ? 4 : 8; };
+    
+    for (int p = 0; p < count; p++)
+        used[data[p]] = true;
+    
+    int colors = 0;
+    int highest = 0;
+    for (int c = 0; c < 256; c++)
+    {
+        if (used[c])
+        {
+            lut[c] = colors;
+            order[colors++] = c;
+            highest = c + 1;
+        }
+    }
+    
+    if (depth_for(colors) < depth_for(highest))
+        return colors;
+    
+    for (int c = 0; c < 256; c++)
+        lut[c] = order[c] = c;
+    
+    return highest;
+}
+
+void extractor::encode_png(std::vector<uint8_t>& out, int width, int height, png_byte color_type, png_byte bit_depth, uint8_t *data, uint8_t *palette, int clear)
+{
+    png_encoder& encoder = png_encoder::local();
+    
+    if (color_type != PNG_COLOR_TYPE_PALETTE)
+    {
+        encoder.encode(out, width, height, color_type, bit_depth, data);
+        return;
+    }
+    
+    uint8_t lut[256];
+    uint8_t order[256];
+    bool used[256] = {};
+    
+    int colors = index_colors(data, width * height, lut, order, used);
+    bit_depth = colors <= 2 ? 1 : colors <= 4 ? 2 : colors <= 16 ? 4 : 8;
+    
+    uint8_t plte[256 * 3];
+    for (int c = 0; c < colors; c++)
+    {
+        plte[c * 3 + 0] = palette[order[c] * 3 + 0];
+        plte[c * 3 + 1] = palette[order[c] * 3 + 1];
+        plte[c * 3 + 2] = palette[order[c] * 3 + 2];
+    }
+    
+    // clear color (if used) gets transparent, tRNS ends right after it
+    
+    uint8_t alpha[256];
+    int alphas = 0;
+    if (clear >= 0 && clear < 256 && used[clear])
+    {
+        alphas = lut[clear] + 1;
+        memset(alpha, 0xff, alphas);
+        alpha[lut[clear]] = 0;
+    }
+    
+    encoder.encode(out, width, height, color_type, bit_depth, data, plte, colors, alpha, alphas, lut);
+}
+
+void extractor::write_png_file(const char *filename, int width, int height, png_byte color_type, png_byte bit_depth, uint8_t *data, uint8_t *palette, int clear)
+{
+    if (_format == format_qoi)
+    {
+        write_qoi_file(filename, width, height, color_type == PNG_COLOR_TYPE_PALETTE ? data : NULL, color_type == PNG_COLOR_TYPE_PALETTE ? palette : NULL, clear, data);
+        return;
+    }
+    
+    std::vector<uint8_t> png;
+    encode_png(png, width, height, color_type, bit_depth, data, palette, clear);
+    _writer.write(filename, std::move(png));
+}
+
+void extractor::write_png_variants(const std::filesystem::path& path, int width, int height, uint8_t *data, uint8_t *palette, int clear)
+{
+    if (_format == format_qoi)
+    {
+        write_qoi_file(path, width, height, data, palette, clear);
+        for (auto& v : _variants)
+            write_qoi_file(path.parent_path() / (path.stem().string() + " [" + v.name + "]" + path.extension().string()), width, height, data, v.palette, clear);
+        
+        return;
+    }
+    
+    // pixels are compressed once, palette variants only get a new PLTE chunk
+    
+    std::vector<uint8_t> png;
+    encode_png(png, width, height, PNG_COLOR_TYPE_PALETTE, 8, data, palette, clear);
+    _writer.write(path, png);
+    
+    if (_variants.empty())
+        return;
+    
+    uint8_t lut[256];
+    uint8_t order[256];
+    bool used[256] = {};
+    int colors = index_colors(data, width * height, lut, order, used);
+    
+    std::vector<uint8_t> variant;
+    for (auto& v : _variants)
+    {
+        variant.assign(png.begin(), png.begin() + 8);
+        
+        for (size_t at = 8; at + 12 <= png.size(); )
+        {
+            uint32_t length = decode::byte_order<false>::read4b(&png[at]);
+            if (length > png.size() - at - 12)
+                break;
+            
+            if (memcmp(&png[at + 4], "PLTE", 4) == 0)
+            {
+                uint8_t chunk[8 + 256 * 3 + 4];
+                memcpy(chunk, &png[at], 8);
+                for (int c = 0; c < colors; c++)
+                    memcpy(chunk + 8 + c * 3, v.palette + order[c] * 3, 3);
+                
+                uint32_t crc = (uint32_t)crc32(0, chunk + 4, 4 + colors * 3);
+                uint8_t *tail = chunk + 8 + colors * 3;
+                tail[0] = crc >> 24;
+                tail[1] = crc >> 16;
+                tail[2] = crc >> 8;
+                tail[3] = crc;
+                variant.insert(variant.end(), chunk, tail + 4);
+            }
+            else
+            {
+                variant.insert(variant.end(), png.begin() + at, png.begin() + at + 12 + length);
+            }
+            
+            at += 12 + length;
+        }
+        
+        std::filesystem::path out = path;
+        out.replace_filename(path.stem().string() + " [" + v.name + "]" + path.extension().string());
+        _writer.write(out, variant);
+    }
+}
+
+void extractor::write_atlas(const std::string& name, vector<AtlasSprite>& sprites)
+{
+    if (sprites.empty())
+        return;
+    
+    // NOTE: sheets are RGBA so every sprite keeps its own palette, 1 pixel gap between sprites
+    
+    const int padding = 1;
+    auto pow2 = [](int v) { int p = 1; while (p < v) p <<= 1; return p; };
+    
+    int sheet_size = 1024;
+    
+    for (auto& s : sprites)
+    {
+        // trim rows and columns of clear color
+        
+        const Entry *e = s.entry;
+        int left = e->width, right = -1, top = -1, bottom = -1;
+        for (int y = 0; y < e->height; y++)
+        {
+            const uint8_t *row = e->buffer.data + y * e->width;
+            int first = 0;
+            int last = e->width - 1;
+            if (s.clear >= 0 && s.clear < 256)
+            {
+                for (; first < e->width && row[first] == s.clear; first++);
+                for (; last > first && row[last] == s.clear; last--);
+                
+                if (first == e->width)
+                    continue;
+            }
+            
+            if (top < 0)
+                top = y;
+            
+            bottom = y;
+            left = std::min(left, first);
+            right = std::max(right, last);
+        }
+        
+        s.sheet = -1;
+        s.left = top < 0 ? 0 : left;
+        s.top = top < 0 ? 0 : top;
+        s.width = top < 0 ? 0 : right - left + 1;
+        s.height = top < 0 ? 0 : bottom - top + 1;
+        
+        sheet_size = std::max(sheet_size, pow2(std::max(s.width, s.height) + padding));
+    }
+    
+    vector<AtlasSprite *> order;
+    for (auto& s : sprites)
+    {
+        if (s.width > 0)
+            order.push_back(&s);
+    }
+    
+    std::stable_sort(order.begin(), order.end(), [](const AtlasSprite *a, const AtlasSprite *b) {
+        return a->height != b->height ? a->height > b->height : a->width > b->width;
+    });
+    
+    vector<skyline_packer> sheets;
+    for (auto s : order)
+    {
+        for (size_t k = 0; k < sheets.size() && s->sheet < 0; k++)
+        {
+            if (sheets[k].insert(s->width + padding, s->height + padding, s->x, s->y))
+                s->sheet = (int)k;
+        }
+        
+        if (s->sheet < 0)
+        {
+            sheets.emplace_back(sheet_size, sheet_size);
+            sheets.back().insert(s->width + padding, s->height + padding, s->x, s->y);
+            s->sheet = (int)sheets.size() - 1;
+        }
+    }
+    
+    std::string ext = _format == format_qoi ? ".qoi" : ".png";
+    std::string map = "{\n    \"sheets\": [";
+    
+    std::map<uint8_t *, vector<uint32_t>> colors;
+    
+    for (size_t k = 0; k < sheets.size(); k++)
+    {
+        int width = pow2(sheets[k].used_width());
+        int height = pow2(sheets[k].used_height());
+        vector<uint32_t> canvas(width * height, 0);
+        
+        for (auto s : order)
+        {
+            if (s->sheet != (int)k)
+                continue;
+            
+            vector<uint32_t>& rgba = colors[s->palette];
+            if (rgba.empty())
+            {
+                rgba.resize(256);
+                blit::expand_palette(s->palette, rgba.data());
+            }
+            
+            for (int y = 0; y < s->height; y++)
+            {
+                const uint8_t *src = s->entry->buffer.data + (s->top + y) * s->entry->width + s->left;
+                blit::row32(src, canvas.data() + (s->y + y) * width + s->x, s->width, s->clear, false, rgba.data());
+            }
+        }
+        
+        std::string sheet = name + " atlas " + std::to_string(k);
+        write_png_file((_out_dir / (sheet + ".png")).string().c_str(), width, height, PNG_COLOR_TYPE_RGBA, 8, (uint8_t *)canvas.data());
+        
+        map += (k ? ", \"" : "\"") + sheet + ext + "\"";
+    }
+    
+    map += "],\n    \"sprites\": [\n";
+    
+    char line[256];
+    for (size_t i = 0; i < sprites.size(); i++)
+    {
+        const AtlasSprite& s = sprites[i];
+        snprintf(line, sizeof(line), "        { \"entry\": %d, \"width\": %d, \"height\": %d, \"sheet\": %d, \"x\": %d, \"y\": %d, \"w\": %d, \"h\": %d, \"left\": %d, \"top\": %d }%s\n",
+                 s.index, s.entry->width, s.entry->height, s.sheet, s.sheet < 0 ? 0 : s.x, s.sheet < 0 ? 0 : s.y, s.width, s.height, s.left, s.top, i + 1 < sprites.size() ? "," : "");
+        map += line;
+    }
+    
+    map += "    ]\n}\n";
+    _writer.write(_out_dir / (name + " atlas.json"), vector<uint8_t>(map.begin(), map.end()));
+}
+
+void extractor::write_tiles(const std::string& name)
+{
+    if (_tilemaps.empty())
+        return;
+    
+    int width, height;
+    vector<uint32_t> sheet;
+    _tiles.render(sheet, width, height);
+    
+    cout << "Tileset " << _tiles.count() << " tiles for " << _tilemaps.size() << " bitmaps" << endl;
+    write_png_file((_out_dir / (name + " tiles.png")).string().c_str(), width, height, PNG_COLOR_TYPE_RGBA, 8, (uint8_t *)sheet.data());
+    
+    // NOTE: little endian: u16 width, u16 height (pixels), u8 tile size, u8 bytes per cell, then cells row by row
+    
+    int cell = _tiles.count() > 0xffff ? 4 : 2;
+    for (const TileMap& map : _tilemaps)
+    {
+        vector<uint8_t> data = { (uint8_t)map.width, (uint8_t)(map.width >> 8), (uint8_t)map.height, (uint8_t)(map.height >> 8), (uint8_t)_tiles.size(), (uint8_t)cell };
+        for (uint32_t c : map.cells)
+        {
+            for (int b = 0; b < cell; b++)
+                data.push_back((uint8_t)(c >> (b * 8)));
+        }
+        
+        _writer.write(_out_dir / (map.name + ".tilemap"), std::move(data));
+    }
+    
+    _tiles = tile_set(_tile_size);
+    _tilemaps.clear();
+}
+
+void extractor::write_phash()
+{
+    if (_phash_distance < 0 || _phashes.empty())
+        return;
+    
+    // hashes of earlier runs into the same directory stay, so versions of a game
+    // extracted one after another are matched against each other; a shard only
+    // lists its hashes, they are matched once all shards are merged (see merge_shards)
+    
+    std::filesystem::path catalog = _out_dir / (_shard_count ? "phash " + shard_suffix() + ".txt" : "phash.txt");
+    
+    vector<PerceptualHash> all;
+    load_phash(catalog, all);
+    merge_phash(all, _phashes);
+    _phashes.clear();
+    
+    save_phash(catalog, all);
+    
+    if (_shard_count == 0)
+        write_phash_matches(all);
 }
 
-void log_data(const uint8_t *p, int f, int s0, int s1, const char *format, ...)
+void extractor::merge_shards(const path& dir)
 {
-    va_list args;
-    va_start(args, format);
-    vprintf(format, args);
-    va_end(args);
-
-    char t0[8] = "]";
-    if (s0 > 24)
+    // NOTE: catalogs of all shards found in dir go into the one of the output directory,
+    // a node that ran into its own output directory just copies its catalog over first
+    
+    vector<path> shards;
+    for (const auto & file : directory_iterator(dir))
     {
-        s0 = 24;
-        strcpy(t0, "...");
+        string f = file.path().filename().string();
+        if (f.rfind("phash shard ", 0) == 0 && utils::get_file_ext(f) == "txt")
+            shards.push_back(file.path());
     }
-
-    char t1[8] = "]";
-    if (s1 > 24)
+    
+    std::sort(shards.begin(), shards.end());
+    
+    std::filesystem::path catalog = _out_dir / "phash.txt";
+    
+    vector<PerceptualHash> all;
+    load_phash(catalog, all);
+    
+    for (const path& shard : shards)
     {
-        s1 = 24;
-        strcpy(t1, "...");
+        vector<PerceptualHash> hashes;
+        load_phash(shard, hashes);
+        merge_phash(all, hashes);
+        
+        cout << "Merged " << shard.filename().string() << " (" << hashes.size() << " hashes)" << endl;
     }
-
-    s1 += s0 + f;
-    s0 += f;
-
-    if (f < s0)
+    
+    if (shards.empty())
     {
-        printf("[");
-        
-        for (int i = f; i < s0; i++)
-            printf(" %.2x", p[i]);
-        
-        printf(" %s", t0);
+        cout << "No shard catalogs found!" << endl;
+        return;
     }
     
-    if (s0 < s1)
+    save_phash(catalog, all);
+    
+    if (_phash_distance >= 0)
+        write_phash_matches(all);
+    
+    for (const path& shard : shards)
+        std::filesystem::remove(shard);
+}
+
+void extractor::load_phash(const path& catalog, vector<PerceptualHash>& hashes)
+{
+    std::ifstream is(catalog);
+    std::string line;
+    while (std::getline(is, line))
     {
-        printf("[");
-        
-        for (int i = s0; i < s1; i++)
-            printf(" %.2x", p[i]);
+        size_t t0 = line.find('\t');
+        size_t t1 = line.find('\t', t0 + 1);
+        if (t0 == std::string::npos || t1 == std::string::npos)
+            continue;
         
-        printf(" %s", t1);
+        hashes.push_back({ strtoull(line.substr(0, t0).c_str(), NULL, 16), line.substr(t0 + 1, t1 - t0 - 1), line.substr(t1 + 1) });
     }
-
-    printf("\n");
 }
 
-void extractor::write_buffer(const std::filesystem::path& path, const Buffer& buffer)
+// fresh hashes replace those of the same asset, the catalog is kept ordered by asset,
+// so it comes out the same however the work was split or ordered
+void extractor::merge_phash(vector<PerceptualHash>& all, const vector<PerceptualHash>& fresh)
 {
-    auto file = std::fstream(path, std::ios::out | std::ios::binary);
-    file.write((char *)buffer.data, buffer.size);
-    file.close();
+    std::set<std::pair<std::string, std::string>> keys;
+    for (const PerceptualHash& h : fresh)
+        keys.insert({ h.platform, h.asset });
+    
+    all.erase(std::remove_if(all.begin(), all.end(), [&](const PerceptualHash& h) { return keys.count({ h.platform, h.asset }) > 0; }), all.end());
+    all.insert(all.end(), fresh.begin(), fresh.end());
+    
+    std::stable_sort(all.begin(), all.end(), [](const PerceptualHash& a, const PerceptualHash& b) {
+        return a.asset != b.asset ? a.asset < b.asset : a.platform < b.platform;
+    });
 }
 
-void extractor::write_png_file(const char *filename, int width, int height, png_byte color_type, png_byte bit_depth, uint8_t *data, uint8_t *palette)
+void extractor::save_phash(const path& catalog, const vector<PerceptualHash>& all)
 {
-    FILE *fp = fopen(filename, "wb");
-    if (!fp)
-        abort();
-
-    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-    if (!png)
-        abort();
-
-    png_infop info = png_create_info_struct(png);
-    if (!info)
-        abort();
-
-    if (setjmp(png_jmpbuf(png)))
-        abort();
-
-    png_init_io(png, fp);
-
-    // Output is 8bit depth, RGBA format.
-    png_set_IHDR(png, info, width, height, bit_depth, color_type, PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    std::string text;
+    char hex[24];
+    for (const PerceptualHash& h : all)
+    {
+        snprintf(hex, sizeof(hex), "%016llx\t", (unsigned long long)h.hash);
+        text += hex + h.platform + "\t" + h.asset + "\n";
+    }
+    
+    _writer.write(catalog, vector<uint8_t>(text.begin(), text.end()));
+}
 
-    int bytewidth = width * 4;
+void extractor::write_phash_matches(const vector<PerceptualHash>& all)
+{
+    std::string text;
+    char hex[24];
+    
+    // near duplicates, grouped transitively
+    
+    hash_index index;
+    for (size_t i = 0; i < all.size(); i++)
+        index.add(all[i].hash, (uint32_t)i);
+    
+    vector<uint32_t> group(all.size());
+    for (size_t i = 0; i < all.size(); i++)
+        group[i] = (uint32_t)i;
     
-    if (color_type == PNG_COLOR_TYPE_PALETTE)
+    auto root = [&](uint32_t i) {
+        while (group[i] != i)
+            i = group[i] = group[group[i]];
+        return i;
+    };
+    
+    vector<uint32_t> ids;
+    for (size_t i = 0; i < all.size(); i++)
     {
-        png_colorp png_palette = new png_color[256];
-        for (int c = 0; c < 256; c++)
+        index.find(all[i].hash, _phash_distance, ids);
+        for (uint32_t j : ids)
         {
-            png_palette[c].red = palette[c * 3 + 0];
-            png_palette[c].green = palette[c * 3 + 1];
-            png_palette[c].blue = palette[c * 3 + 2];
+            uint32_t a = root((uint32_t)i);
+            uint32_t b = root(j);
+            group[std::max(a, b)] = std::min(a, b);
         }
-        
-        png_set_PLTE(png, info, png_palette, 256);
-        
-        bytewidth = width;
-    }
-    else if (color_type == PNG_COLOR_TYPE_GRAY)
-    {
-        bytewidth = width / (8 / bit_depth);
-    }
-    else if (bit_depth == 1)
-    {
-        bytewidth = width / 8;
     }
-    else if (bit_depth == 2)
-    {
-        bytewidth = width / 4;
-    }
-    else if (bit_depth == 4)
+    
+    std::map<uint32_t, vector<uint32_t>> groups;
+    for (size_t i = 0; i < all.size(); i++)
+        groups[root((uint32_t)i)].push_back((uint32_t)i);
+    
+    int count = 0;
+    for (const auto& g : groups)
     {
-        bytewidth = width / 2;
+        if (g.second.size() < 2)
+            continue;
+        
+        for (uint32_t i : g.second)
+        {
+            snprintf(hex, sizeof(hex), "%016llx  ", (unsigned long long)all[i].hash);
+            text += hex + all[i].platform + "  " + all[i].asset + "\n";
+        }
+        
+        text += "\n";
+        count++;
     }
-
-    png_write_info(png, info);
-
-    png_bytep row_pointers[sizeof(png_bytep) * height]; // (png_bytep *)malloc(sizeof(png_bytep) * height);
-    for (int y = 0; y < height; y++)
-        row_pointers[y] = data + y * bytewidth;
     
-    png_write_image(png, row_pointers);
-    png_write_end(png, NULL);
-
-    fclose(fp);
+    cout << "Perceptual hashes " << all.size() << ", " << count << " groups of near duplicates" << endl;
+    _writer.write(_out_dir / "phash matches.txt", vector<uint8_t>(text.begin(), text.end()));
+}
 
-    // png_data_freer(&png, &info, PNG_USER_WILL_FREE_DATA, PNG_FREE_PLTE|PNG_FREE_TRNS|PNG_FREE_HIST);
-    // png_destroy_write_struct(&png, &info);
-    png_uint_32 mask = PNG_FREE_ALL;
-    mask &= ~PNG_FREE_ROWS;
-    png_free_data(png, info, mask, -1);
+void extractor::write_qoi_file(std::filesystem::path path, int width, int height, uint8_t *indexed, uint8_t *palette, int clear, uint8_t *rgba)
+{
+    std::vector<uint8_t> out;
+    if (indexed)
+        qoi::encode(out, width, height, indexed, palette, clear);
+    else
+        qoi::encode(out, width, height, rgba);
+    
+    _writer.write(path.replace_extension(".qoi"), std::move(out));
 }
 
 uint16_t extractor::read2b(const uint8_t *buffer)
 {
-    if (_is_little_endian)
-    {
-        return *(uint16_t *)(buffer);
-    }
-    else
-    {
-        uint8_t bytes[2];
-        bytes[1] = buffer[0];
-        bytes[0] = buffer[1];
-        return *(uint16_t *)(bytes);
-    }
+    return _is_little_endian ? decode::byte_order<true>::read2b(buffer) : decode::byte_order<false>::read2b(buffer);
 }
 
 uint32_t extractor::read4b(const uint8_t *buffer)
 {
-    if (_is_little_endian)
-    {
-        return *(uint32_t *)(buffer);
-    }
-    else
-    {
-        uint8_t bytes[4];
-        bytes[3] = buffer[0];
-        bytes[2] = buffer[1];
-        bytes[1] = buffer[2];
-        bytes[0] = buffer[3];
-        return *(uint32_t *)(bytes);
-    }
+    return _is_little_endian ? decode::byte_order<true>::read4b(buffer) : decode::byte_order<false>::read4b(buffer);
 }
 
-int extractor::asset_size(const uint8_t *buffer)
+int extractor::asset_size(const uint8_t *buffer, uint32_t mod)
 {
-    int h0 = buffer[0];
+    int h0 = mod + buffer[0];
     int h1 = buffer[1];
 
     switch (h0)
@@ -330,7 +1283,7 @@ int extractor::asset_size(const uint8_t *buffer)
         {
             int width = read2b(buffer + 2) + 1;
             int height = read2b(buffer + 4) + 1;
-            return width / (_platform_ext == "mo" ? 4 :  2) * height;
+            return width / _codec.bitmap_ratio * height;
         }
         case 0x10:
         case 0x12:
@@ -392,6 +1345,9 @@ bool extractor::find_assets(const uint8_t *buffer, int length, uint32_t& address
 
     int add = _is_packed ? 0 : 6;
 
+    if (0xe + add + 4 > length)
+        return false;
+    
     // look for graphics
     
     location = read4b(buffer + 0xe + add) + add;
@@ -400,8 +1356,10 @@ bool extractor::find_assets(const uint8_t *buffer, int length, uint32_t& address
     
     address = (location + read4b(buffer + location));
     entries = read2b(buffer + location + 4);
-    if (entries)
+    if (entries && address < (uint32_t)length)
     {
+        entries = std::min(entries, (length - address) / 4);
+        
         cout << "Found gfx address block [0x" << std::hex << std::setw(6) << std::setfill('0') << location << "]" << " [0x" << std::hex << std::setw(6) << std::setfill('0') << address << "]" << endl;
         mod = 0;
         return true;
@@ -410,13 +1368,15 @@ bool extractor::find_assets(const uint8_t *buffer, int length, uint32_t& address
     // look for sound
     
     location = read4b(buffer + 0xe + add) + add;
-    if (location + 6 >= length)
+    if (location + 0x12 >= length)
         return false;
 
     address = read4b(buffer + 0xc + location) + location;
     entries = read2b(buffer + 0x10 + location);
-    if (entries)
+    if (entries && address < (uint32_t)length)
     {
+        entries = std::min(entries, (length - address) / 4);
+        
         cout << "Found snd address block [0x" << std::hex << std::setw(6) << std::setfill('0') << location << "]" << " [0x" << std::hex << std::setw(6) << std::setfill('0') << address << "]" << endl;
         mod = 0x100;
         return true;
@@ -437,6 +1397,8 @@ void extractor::set_palette(Buffer& script, uint32_t address, uint32_t entries)
         uint32_t value = read4b(script.data + position);
 
         uint32_t location = position + 2 + value;
+        if (location < 2 || location > script.size)
+            continue;
 
         h0 = script[location - 2];
         h1 = script[location - 1];
@@ -466,187 +1428,211 @@ Entry *extractor::get_entry_data(Buffer& script, uint32_t mod, uint32_t address,
         return _entry_map[index];
     }
 
-    int h0;
-    int h1;
+    return _is_little_endian ? parse_entry<true>(script, mod, address, index) : parse_entry<false>(script, mod, address, index);
+}
+
+void extractor::release_entry(Entry *entry)
+{
+    delete [] entry->buffer.data;
+    entry->buffer = Buffer();
+    entry->video.reset();
+}
+
+// videos, samples and patterns, the entries copied whole out of the script
+bool extractor::is_bulk(int h0)
+{
+    return h0 == 0x40 || h0 == 0x100 || h0 == 0x101 || h0 == 0x102 || h0 == 0x104;
+}
+
+// what decoding all entries of a script takes, as far as the address table tells
+uint64_t extractor::footprint(const uint8_t *buffer, int length, uint32_t address, uint32_t entries, uint32_t mod)
+{
+    uint64_t bytes = length;
+    
+    for (uint32_t i = 0; i < entries; i++)
+    {
+        uint64_t position = address + (uint64_t)i * 4;
+        if (position + 4 > (uint64_t)length)
+            break;
+        
+        uint64_t location = position + 2 + read4b(buffer + position);
+        if (location + 4 > (uint64_t)length)
+            continue;
+        
+        const uint8_t *header = buffer + location - 2;
+        int h0 = mod + header[0];
+        if (h0 == 0x00 || h0 == 0x02 || h0 == 0x10 || h0 == 0x12 || h0 == 0x14 || h0 == 0x16)
+        {
+            // one byte per pixel once decoded
+            bytes += (uint64_t)(read2b(header + 2) + 1) * (read2b(header + 4) + 1);
+        }
+        else if (h0 == 0xfe)
+        {
+            bytes += 256 * 3;
+        }
+        else
+        {
+            bytes += std::max(asset_size(header, mod), 0);
+        }
+    }
+    
+    return bytes;
+}
 
+template <bool little_endian>
+Entry *extractor::parse_entry(Buffer& script, uint32_t mod, uint32_t address, uint32_t index)
+{
+    // NOTE: every structure is checked against script size before it is read, broken entries end up as unknown
+    
+    decode::cursor<little_endian> cur(script.data, script.size);
+    
     uint32_t position = address + index * 4;
-    uint32_t value = read4b(script.data + position);
+    if (cur.seek(position, 4) == false)
+        return (_entry_map[index] = new Entry());
+    
+    uint32_t value = cur.read4b();
     uint32_t location = position + 2 + value;
+    if (location < 2 || cur.seek(location - 2, 2) == false)
+        return (_entry_map[index] = new Entry());
 
-    h0 = mod + script[location - 2];
-    h1 = script[location - 1];
+    int h0 = mod + cur.read1b();
+    int h1 = cur.read1b();
+    
+    // NOTE: sizes go up to 0x10000 x 0x10000, pixel counts are taken in 64 bit and bitmaps are only
+    // accepted if later 32 bit RGBA handling (int arithmetic) still holds them
+    
+    auto fits = [](uint64_t pixels) { return pixels <= INT_MAX / 4; };
     
     switch (h0)
     {
         case 0x01:
         {
-            return (_entry_map[index] = new Entry(data_type::rectangle, location, Buffer()));
+            if (cur.has(4) == false)
+                break;
+            
+            int width = cur.read2b() + 1;
+            int height = cur.read2b() + 1;
+            return (_entry_map[index] = new Entry(data_type::rectangle, location, Buffer(), width, height));
         }
         case 0x00:
         case 0x02:
         {
-            int width = read2b(script.data + location) + 1;
-            int height = read2b(script.data + location + 2) + 1;
-            int at = location + 4;
-            int to = 0;
+            if (cur.has(4) == false)
+                break;
             
-            if (_platform_ext == "mo")
-            {
-                // 2 bit
-                uint8_t *data = new uint8_t[width * height];
-                uint8_t pixels[16];
-                
-                for (int b = 0; b < width * height; b+=16)
-                {
-                    for (int c = 0; c < 8; c++)
-                    {
-                        uint8_t rot = (7 - c);
-                        uint8_t mask = 1 << rot;
-                        pixels[0 + c] = (((script[at + 0] & mask) >> rot) << 7) | ((script[at + 2] & mask) >> rot);
-                        pixels[8 + c] = (((script[at + 1] & mask) >> rot) << 7) | ((script[at + 3] & mask) >> rot);
-                    }
-                    
-                    for (int d = 0; d < 16; d++)
-                    {
-                        data[to + d] = pixels[d] ? 255 : 0;
-                    }
-                    
-                    at+=4;
-                    to+=16;
-                }
-                
-                return (_entry_map[index] = new Entry(data_type::image2, location, Buffer(data, width * height)));
-            }
-            else if ((_type & 1) == 0 && _platform_ext == "ao")
-            {
-                // 3 bit
-                uint8_t *data = new uint8_t[width * height * 1024];
-                memset(data, 0, width * height);
-                uint8_t pixels[16];
-
-                for (int b = 0; b < width * height; b+=16)
-                {
-                    memset(pixels, 0, 16);
-                    for (int c = 0; c < 8; c++)
-                    {
-                        uint32_t rot = (7 - c);
-                        uint32_t mask = 1 << rot;
-                        pixels[8 + c] = (((script[at + 1] & mask) >> rot) << 0) | (((script[at + 3] & mask) >> rot) << 1) | (((script[at + 5] & mask) >> rot) << 2);
-                        pixels[0 + c] = (((script[at + 0] & mask) >> rot) << 0) | (((script[at + 2] & mask) >> rot) << 1) | (((script[at + 4] & mask) >> rot) << 2);
-                    }
-
-                    for (int d = 0; d < 16; d++)
-                    {
-                        data[to + d] = pixels[d];
-                    }
-
-                    at+=8;
-                    to+=16;
-                }
-
-                return (_entry_map[index] = new Entry(data_type::image2, location, Buffer(data, width * height)));
-            }
-            else
-            {
-                uint8_t *data = new uint8_t[width * height];
-                
-                for (int x = 0; x < (width / 2) * height; x++, at++)
-                {
-                    uint8_t r = script[at];
-                    uint8_t a = ((r & 0b11110000) >> 4);
-                    uint8_t b = (r & 0b00001111);
-
-                    data[to++] = a;
-                    data[to++] = b;
-                }
-                
-                return (_entry_map[index] = new Entry(data_type::image4ST, location, Buffer(data, width * height)));
-            }
-            break;
+            int width = cur.read2b() + 1;
+            int height = cur.read2b() + 1;
+            
+            // NOTE: planar bitmaps are decoded in groups of 16 pixels
+            
+            uint64_t pixels = (uint64_t)width * height;
+            uint64_t bytes = _codec.bitmap_type == data_type::image4ST ? (uint64_t)(width / 2) * height : ((pixels + 15) / 16) * (16 / _codec.bitmap_ratio);
+            if (fits(pixels) == false || cur.has(bytes) == false)
+                break;
+            
+            uint8_t *data = new uint8_t[(pixels + 15) & ~15];
+            _codec.bitmap(script.data + location + 4, data, _codec.bitmap_type == data_type::image4ST ? (width / 2) * height * 2 : (int)pixels);
+            
+            return (_entry_map[index] = new Entry(_codec.bitmap_type, location, Buffer(data, (uint32_t)pixels), width, height));
         }
         case 0x10:
         case 0x12:
         {
-            int width = read2b(script.data + location) + 1;
-            int height = read2b(script.data + location + 2) + 1;
-            uint8_t *data = new uint8_t[width * height];
-            int at = location + 4 + 2;
-            int to = 0;
+            if (cur.has(4) == false)
+                break;
+            
+            int width = cur.read2b() + 1;
+            int height = cur.read2b() + 1;
+            uint64_t pixels = (uint64_t)width * height;
+            if (fits(pixels) == false || cur.has(2 + (uint64_t)(width / 2) * height) == false)
+                break;
+            
+            uint8_t *data = new uint8_t[pixels];
 
             // int clear = script[location + 5];
             int palIndex = script[location + 4];
             
-            for (int x = 0; x < (width / 2) * height; x++, at++)
-            {
-                uint8_t r = script[at];
-                uint8_t a = palIndex + ((r & 0b11110000) >> 4);
-                uint8_t b = palIndex + (r & 0b00001111);
-                
-                data[to++] = a;
-                data[to++] = b;
-            }
+            decode::chunky4(script.data + location + 4 + 2, data, (width / 2) * height * 2, palIndex);
             
-            return (_entry_map[index] = new Entry(data_type::image4, location, Buffer(data, width * height)));
+            return (_entry_map[index] = new Entry(data_type::image4, location, Buffer(data, (uint32_t)pixels), width, height));
         }
         case 0x14:
         case 0x16:
         {
-            int width = read2b(script.data + location) + 1;
-            int height = read2b(script.data + location + 2) + 1;
-            uint8_t *data = new uint8_t[width * height];
-            memcpy(data, script.data + location + 4 + 2, width * height);
+            if (cur.has(4) == false)
+                break;
+            
+            int width = cur.read2b() + 1;
+            int height = cur.read2b() + 1;
+            uint64_t pixels = (uint64_t)width * height;
+            if (fits(pixels) == false || cur.has(2 + pixels) == false)
+                break;
+            
+            uint8_t *data = new uint8_t[pixels];
+            memcpy(data, script.data + location + 4 + 2, pixels);
                 
-            return (_entry_map[index] = new Entry(data_type::image8, location, Buffer(data, width * height)));
+            return (_entry_map[index] = new Entry(data_type::image8, location, Buffer(data, (uint32_t)pixels), width, height));
         }
         case 0x40:
         {
-            uint32_t size = read4b(script.data + location);
-            char *fliname = (char *)&script[location + 4];
+            // size, 26 bytes name, FLI header (always little endian)
+            
+            if (cur.has(30 + 8) == false)
+                break;
+            
+            uint32_t size = cur.read4b();
+            std::string fliname((char *)cur.ptr(), strnlen((char *)cur.ptr(), 26));
             cout << "FLI video (" << fliname << ") " << std::dec << size << " bytes [";
 
-            size = (*(uint32_t *)(&script[location + 30]));
-            uint16_t frames = (*(uint16_t *)(&script[location + 36]));
+            size = decode::byte_order<true>::read4b(cur.ptr() + 26);
+            uint16_t frames = decode::byte_order<true>::read2b(cur.ptr() + 32);
 
             cout << "size: " << std::dec << size << " frames: "  << std::dec << frames << "]" << endl;
             
+            if (cur.has(26 + size) == false)
+                break;
+            
             uint8_t *data = new uint8_t[size];
             memcpy(data, &script[location + 30], size);
+            
+            Entry *entry = new Entry(data_type::video, location, Buffer(data, size));
+            
+            // frame positions and keyframes are taken in this one pass, frames are then reached through them
+            if (_convert_video)
+            {
+                entry->video = std::make_shared<fli_decoder>(data, size);
+                entry->video->build_index();
+            }
 
-            return (_entry_map[index] = new Entry(data_type::video, location, Buffer(data, size)));
+            return (_entry_map[index] = entry);
         }
         case 0xfe:
         {
             uint8_t *palette_data = new uint8_t[256 * 3];
             memcpy(palette_data, _default_pal, 256 * 3);
 
-            int to = 0;
-
             if (h1 == 0x00)
             {
-                if (_platform_ext == "co")
-                {
-                    for (s32 i = 0; i < 16; i++)
-                    {
-                        palette_data[to++] = (script[location + i * 2 + 0] & 0b00001111) << 4;
-                        palette_data[to++] = (script[location + i * 2 + 1] >> 4) << 4;
-                        palette_data[to++] = (script[location + i * 2 + 1] & 0b00001111) << 4;
-                    }
-                }
-                else
+                if (cur.has(32) == false)
                 {
-                    for (int i = 0; i < 16; i++)
-                    {
-                        palette_data[to++] = (script[location + i * 2 + 0] & 0b00001111) << 5;
-                        palette_data[to++] = (script[location + i * 2 + 1] >> 4) << 5;
-                        palette_data[to++] = (script[location + i * 2 + 1] & 0b00001111) << 5;
-                    }
+                    delete [] palette_data;
+                    break;
                 }
                 
+                _codec.palette4(script.data + location, palette_data);
+                
                 _active_pal = palette_data;
                 return (_entry_map[index] = new Entry(data_type::palette4, location, Buffer(palette_data, 256 * 3)));
             }
             else
             {
+                if (cur.has(2 + (h1 + 1) * 3) == false)
+                {
+                    delete [] palette_data;
+                    break;
+                }
+                
+                int to = 0;
                 for (int f = 0; f < h1 + 1; f++)
                 {
                     palette_data[to++] = script[2 + location + (f * 3) + 0];
@@ -660,183 +1646,28 @@ Entry *extractor::get_entry_data(Buffer& script, uint32_t mod, uint32_t address,
         }
         case 0xff:
         {
-            uint8_t *data = new uint8_t[composite_width * composite_height];
-            memset(data, 0, composite_width * composite_height);
+            // draw call
+            // uint8    command (0 normal, )
+            // uint8    entry
+            // uint16   x origin (from left side of screen to bitmap center)
+            // uint16   draw order
+            // uint16   y origin (from bottom side of screen to bitmap center)
             
-            if (h1 == 0)
-            {
-                // clear screen?
-                return (_entry_map[index] = new Entry(data_type::composite, location, Buffer(data, composite_width * composite_height)));
-            }
-            else
-            {
-                // draw call
-                // uint8    command (0 normal, )
-                // uint8    entry
-                // uint16   x origin (from left side of screen to bitmap center)
-                // uint16   draw order
-                // uint16   y origin (from bottom side of screen to bitmap center)
-                
-                std::map<int, std::vector<int>> layers;
-
-                // HACK: we don't know where on screen script wants to draw
-                // so, to actually display anything, check if positions fit screen, if not center it.
-                
-                int minX = composite_width;
-                int minY = composite_height;
-                int maxX = 0;
-                int maxY = 0;
-                
-                for (int b = 0; b < h1; b++)
-                {
-                    uint8_t index = script[b * 8 + location + (_is_little_endian ? 0 : 1)];
-                    int16_t x = read2b(script.data + b * 8 + location + 2);
-                    int16_t d = read2b(script.data + b * 8 + location + 4);
-                    int16_t y = read2b(script.data + b * 8 + location + 6);
-                    
-                    if (index >= 0 && index < entries)
-                    {
-                        Entry *entry = get_entry_data(script, mod, address, entries, index);
-                        if (entry->type == data_type::image2 || entry->type == data_type::image4ST || entry->type == data_type::image4 || entry->type == data_type::image8)
-                        {
-                            int width = read2b(script.data + entry->position) + 1;
-                            int height = read2b(script.data + entry->position + 2) + 1;
-                            int xx = 1 + x - ((width + 1) / 2);
-                            if (xx < minX)
-                                minX = xx;
-                            
-                            // NOTE: works in colorado
-                            // int yy = composite_height - (d + y + ((height + 1) / 2));
-                            int yy = composite_height - (y + ((height + 1) / 2));
-                            if (yy < minY)
-                                minY = yy;
-                            
-                            if (xx + width > maxX)
-                                maxX = xx + width;
-                            
-                            if (yy + height > maxY)
-                                maxY = yy + height;
-                        }
-                    }
-                    
-                    layers[d].push_back(b);
-                }
-                
-                int modX = 0;
-                int modY = 0;
-                if (minX < 0 || maxX >= composite_width)
-                {
-                    modX = (composite_width / 2) - (((maxX - minX) / 2) + minX);
-                }
-                
-                if (minY < 0 || maxY >= composite_height)
-                {
-                    modY = (composite_height / 2) - (((maxY - minY) / 2) + minY);
-                }
-                
-                for (auto it = layers.rbegin(); it != layers.rend(); it++)
-                {
-                    for (auto &b: it->second)
-                    {
-                        uint8_t cmd = script[b * 8 + location + (_is_little_endian ? 1 : 0)];
-                        uint8_t index = script[b * 8 + location + (_is_little_endian ? 0 : 1)];
-                        int16_t x = read2b(script.data + b * 8 + location + 2);
-                        int16_t d = read2b(script.data + b * 8 + location + 4);
-                        int16_t y = read2b(script.data + b * 8 + location + 6);
-
-                        if (index >= 0 && index < entries)
-                        {
-                            Entry *entry = get_entry_data(script, mod, address, entries, index);
-                            if (entry->type != none && entry->type != unknown)
-                            {
-                                int width = read2b(script.data + entry->position) + 1;
-                                int height = read2b(script.data + entry->position + 2) + 1;
-                                int xx = 1 + x - ((width + 1) / 2);
-                                xx += modX;
-                                
-                                // int yy = composite_height - (d + y + ((height + 1) / 2));
-                                int yy = composite_height - (y + ((height + 1) / 2));
-                                yy += modY;
-                                
-                                int vs = 0;
-                                int vf = yy;
-                                int vt = height;
-                                if (vf < 0)
-                                {
-                                    vf = 0;
-                                    vt += yy;
-                                    vs -= yy;
-                                }
-                                
-                                if (vt + vf >= composite_height)
-                                {
-                                    vt = composite_height - vf;
-                                }
-                                
-                                int hs = 0;
-                                int hf = xx;
-                                int ht = width;
-                                if (hf < 0)
-                                {
-                                    hf = 0;
-                                    ht += xx;
-                                    hs -= xx;
-                                }
-                                
-                                if (ht + hf >= composite_width)
-                                {
-                                    ht = composite_width - hf;
-                                }
-                                
-                                if (entry->type == data_type::image2 || entry->type == data_type::image4ST || entry->type == data_type::image4 || entry->type == data_type::image8)
-                                {
-                                    int clear = 0;
-                                    if (entry->type == data_type::image4)
-                                    {
-                                        clear = script[entry->position + 5] + script[entry->position + 4];
-                                    }
-                                    
-                                    if (entry->type == data_type::image8)
-                                    {
-                                        clear = script[entry->position + 5];
-                                    }
-                                    
-                                    for (int h = vs; h < vs + vt; h++)
-                                    {
-                                        for (int w = hs; w < hs + ht; w++)
-                                        {
-                                            uint8_t color = entry->buffer.data[(cmd ? width - (w + 1) : w) + h * width];
-                                            if (color != clear)
-                                            {
-                                                uint8_t *ptr = data + xx + w + ((yy + h) * composite_width);
-                                                *ptr = color;
-                                            }
-                                        }
-                                    }
-                                }
-                                else if (entry->type == data_type::rectangle)
-                                {
-                                    if (ht > 0)
-                                    {
-                                        for (int h = vs; h < vt; h++)
-                                        {
-                                            memset(data + hf + ((yy + h) * composite_width), 0, ht);
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-                
-                return (_entry_map[index] = new Entry(data_type::composite, location, Buffer(data, composite_width * composite_height)));
-            }
+            // NOTE: composites are rendered when saved (see layout_composite)
+            
+            if (cur.has(h1 * 8) == false)
+                break;
+            
+            return (_entry_map[index] = new Entry(data_type::composite, location, Buffer()));
         }
         case 0x100:
         case 0x104:
         {
-            uint32_t len = read4b(script.data + location) - 1;
-            if (location + len >= script.size)
+            if (cur.has(4) == false)
+                break;
+            
+            uint32_t len = cur.read4b() - 1;
+            if (cur.has(len) == false)
                 break;
             
             uint8_t *data = new uint8_t[len];
@@ -847,14 +1678,26 @@ Entry *extractor::get_entry_data(Buffer& script, uint32_t mod, uint32_t address,
         case 0x101:
         case 0x102:
         {
-            uint32_t len = read4b(script.data + location) - 1;
-            if (location + len >= script.size)
+            if (cur.has(0x10 - 2) == false)
+                break;
+            
+            uint32_t len = cur.read4b() - 1;
+            if (len < 0x10 || cur.has(len - 6) == false)
                 break;
 
             len -= 0x10;
             
             uint8_t *data = new uint8_t[len];
-            memcpy(data, script.data + location + 0x10 - 2, len);
+            if (script[location + 4] == 1)
+            {
+                // fibonacci delta packed
+                uint32_t packed = (len + 1) >> 1;
+                audio::decode_fibonacci(script.data + location + 0x10 - 2, packed, data, len);
+            }
+            else
+            {
+                memcpy(data, script.data + location + 0x10 - 2, len);
+            }
 
             return (_entry_map[index] = new Entry(data_type::sample, location, Buffer(data, len)));
         }
@@ -873,6 +1716,303 @@ Entry *extractor::get_entry_data(Buffer& script, uint32_t mod, uint32_t address,
     return (_entry_map[index] = new Entry());
 }
 
+void extractor::layout_composite(Buffer& script, uint32_t mod, uint32_t address, uint32_t entries, uint32_t location, int count, vector<Blit>& blits)
+{
+    blits.clear();
+    if (count == 0)
+    {
+        // clear screen?
+        return;
+    }
+    
+    std::vector<DrawCall> calls(count);
+    _codec.draw_calls(script.data + location, count, calls.data());
+    
+    std::map<int, std::vector<int>> layers;
+
+    // HACK: we don't know where on screen script wants to draw
+    // so, to actually display anything, check if positions fit screen, if not center it.
+    
+    int minX = composite_width;
+    int minY = composite_height;
+    int maxX = 0;
+    int maxY = 0;
+    
+    for (int b = 0; b < count; b++)
+    {
+        uint8_t index = calls[b].index;
+        int16_t x = calls[b].x;
+        int16_t d = calls[b].order;
+        int16_t y = calls[b].y;
+        
+        if (index >= 0 && index < entries)
+        {
+            Entry *entry = get_entry_data(script, mod, address, entries, index);
+            if (entry->type == data_type::image2 || entry->type == data_type::image4ST || entry->type == data_type::image4 || entry->type == data_type::image8)
+            {
+                int width = entry->width;
+                int height = entry->height;
+                int xx = 1 + x - ((width + 1) / 2);
+                if (xx < minX)
+                    minX = xx;
+                
+                // NOTE: works in colorado
+                // int yy = composite_height - (d + y + ((height + 1) / 2));
+                int yy = composite_height - (y + ((height + 1) / 2));
+                if (yy < minY)
+                    minY = yy;
+                
+                if (xx + width > maxX)
+                    maxX = xx + width;
+                
+                if (yy + height > maxY)
+                    maxY = yy + height;
+            }
+        }
+        
+        layers[d].push_back(b);
+    }
+    
+    int modX = 0;
+    int modY = 0;
+    if (minX < 0 || maxX >= composite_width)
+    {
+        modX = (composite_width / 2) - (((maxX - minX) / 2) + minX);
+    }
+    
+    if (minY < 0 || maxY >= composite_height)
+    {
+        modY = (composite_height / 2) - (((maxY - minY) / 2) + minY);
+    }
+    
+    for (auto it = layers.rbegin(); it != layers.rend(); it++)
+    {
+        for (auto &b: it->second)
+        {
+            uint8_t index = calls[b].index;
+            int16_t x = calls[b].x;
+            int16_t y = calls[b].y;
+
+            if (index >= 0 && index < entries)
+            {
+                Entry *entry = get_entry_data(script, mod, address, entries, index);
+                if (entry->type != none && entry->type != unknown)
+                {
+                    Blit blit;
+                    blit.index = index;
+                    blit.entry = entry;
+                    blit.cmd = calls[b].cmd;
+                    
+                    int width = entry->width;
+                    int height = entry->height;
+                    blit.x = 1 + x - ((width + 1) / 2) + modX;
+                    
+                    // int yy = composite_height - (d + y + ((height + 1) / 2));
+                    blit.y = composite_height - (y + ((height + 1) / 2)) + modY;
+                    
+                    int vs = 0;
+                    int vf = blit.y;
+                    int vt = height;
+                    if (vf < 0)
+                    {
+                        vf = 0;
+                        vt += blit.y;
+                        vs -= blit.y;
+                    }
+                    
+                    if (vt + vf >= composite_height)
+                    {
+                        vt = composite_height - vf;
+                    }
+                    
+                    int hs = 0;
+                    int hf = blit.x;
+                    int ht = width;
+                    if (hf < 0)
+                    {
+                        hf = 0;
+                        ht += blit.x;
+                        hs -= blit.x;
+                    }
+                    
+                    if (ht + hf >= composite_width)
+                    {
+                        ht = composite_width - hf;
+                    }
+                    
+                    // NOTE: rectangles were always drawn down to row vt, keep that
+                    
+                    blit.area.left = hf;
+                    blit.area.right = hf + std::max(ht, 0);
+                    blit.area.top = blit.y + vs;
+                    blit.area.bottom = std::max(entry->type == data_type::rectangle ? blit.y + vt : blit.y + vs + vt, blit.area.top);
+                    
+                    blit.clear = 0;
+                    if (entry->type == data_type::image4)
+                    {
+                        blit.clear = script[entry->position + 5] + script[entry->position + 4];
+                    }
+                    
+                    if (entry->type == data_type::image8)
+                    {
+                        blit.clear = script[entry->position + 5];
+                    }
+                    
+                    blits.push_back(blit);
+                }
+            }
+        }
+    }
+}
+
+template <typename pixel>
+const pixel *extractor::render_composite(const vector<Blit>& blits, LayerStack<pixel>& stack, uint8_t *palette, vector<uint8_t *> *pal_overrides)
+{
+    // background stays 0 (transparent in 32 bit), every sprite is drawn with its own palette
+    
+    if (stack.canvas.empty() || stack.palette != palette)
+    {
+        stack.canvas.assign(composite_width * composite_height, 0);
+        stack.blits.clear();
+        stack.palette = palette;
+    }
+    
+    // keep layers drawn from the same (entry, x, y, cmd) prefix, undo the rest
+    
+    size_t keep = 0;
+    while (keep < blits.size() && keep < stack.blits.size())
+    {
+        const Blit& a = blits[keep];
+        const Blit& b = stack.blits[keep];
+        if (a.index != b.index || a.x != b.x || a.y != b.y || a.cmd != b.cmd)
+            break;
+        
+        keep++;
+    }
+    
+    Bounds dirty = { composite_width, composite_height, 0, 0 };
+    for (size_t l = keep; l < stack.blits.size(); l++)
+    {
+        const Bounds& area = stack.blits[l].area;
+        if (area.left < area.right && area.top < area.bottom)
+        {
+            dirty.left = std::min(dirty.left, area.left);
+            dirty.top = std::min(dirty.top, area.top);
+            dirty.right = std::max(dirty.right, area.right);
+            dirty.bottom = std::max(dirty.bottom, area.bottom);
+        }
+    }
+    
+    auto colors = [&](const Blit& b) -> const uint32_t * {
+        
+        if constexpr (sizeof(pixel) == 1)
+            return NULL;
+        
+        uint8_t *pal = palette_for(b.index, pal_overrides, palette);
+        vector<uint32_t>& rgba = stack.colors[pal];
+        if (rgba.empty())
+        {
+            rgba.resize(256);
+            blit::expand_palette(pal, rgba.data());
+        }
+        
+        return rgba.data();
+    };
+    
+    if (dirty.left < dirty.right && dirty.top < dirty.bottom)
+    {
+        for (int y = dirty.top; y < dirty.bottom; y++)
+        {
+            std::fill_n(stack.canvas.data() + y * composite_width + dirty.left, dirty.right - dirty.left, 0);
+        }
+        
+        for (size_t l = 0; l < keep; l++)
+        {
+            draw_blit(blits[l], dirty, stack.canvas.data(), colors(blits[l]));
+        }
+    }
+    
+    const Bounds screen = { 0, 0, composite_width, composite_height };
+    for (size_t l = keep; l < blits.size(); l++)
+    {
+        draw_blit(blits[l], screen, stack.canvas.data(), colors(blits[l]));
+    }
+    
+    stack.blits = blits;
+    return stack.canvas.data();
+}
+
+template <typename pixel>
+static void draw_area(const Blit& b, const Bounds& clip, pixel *data, const uint32_t *colors)
+{
+    Bounds a = { std::max(b.area.left, clip.left), std::max(b.area.top, clip.top), std::min(b.area.right, clip.right), std::min(b.area.bottom, clip.bottom) };
+    if (a.left >= a.right || a.top >= a.bottom)
+        return;
+    
+    const Entry *entry = b.entry;
+    int count = a.right - a.left;
+    
+    if (entry->type == data_type::image2 || entry->type == data_type::image4ST || entry->type == data_type::image4 || entry->type == data_type::image8)
+    {
+        int width = entry->width;
+        int w = a.left - b.x;
+        for (int y = a.top; y < a.bottom; y++)
+        {
+            const uint8_t *src = entry->buffer.data + (y - b.y) * width + (b.cmd ? width - (w + 1) : w);
+            if constexpr (sizeof(pixel) == 1)
+                blit::row8(src, data + a.left + y * composite_width, count, b.clear, b.cmd != 0);
+            else
+                blit::row32(src, data + a.left + y * composite_width, count, b.clear, b.cmd != 0, colors);
+        }
+    }
+    else if (entry->type == data_type::rectangle)
+    {
+        for (int y = a.top; y < a.bottom; y++)
+        {
+            if constexpr (sizeof(pixel) == 1)
+                memset(data + a.left + y * composite_width, 0, count);
+            else
+                blit::fill32(data + a.left + y * composite_width, count, colors[0]);
+        }
+    }
+}
+
+void extractor::draw_blit(const Blit& b, const Bounds& clip, uint8_t *data, const uint32_t *colors)
+{
+    draw_area(b, clip, data, colors);
+}
+
+void extractor::draw_blit(const Blit& b, const Bounds& clip, uint32_t *data, const uint32_t *colors)
+{
+    draw_area(b, clip, data, colors);
+}
+
+uint8_t *extractor::palette_for(uint32_t index, vector<uint8_t *> *pal_overrides, uint8_t *fallback)
+{
+    return pal_overrides && pal_overrides->size() > index && (*pal_overrides)[index] ? (*pal_overrides)[index] : fallback;
+}
+
+const char *string_for_platform(alis_platform platform)
+{
+    switch (platform)
+    {
+        case atari:
+            return "atari";
+        case falcon:
+            return "falcon";
+        case amiga:
+            return "amiga";
+        case aga:
+            return "aga";
+        case mac:
+            return "mac";
+        case dos:
+            return "dos";
+    }
+    
+    return "unknown";
+}
+
 const char *string_for_type(data_type type)
 {
     switch (type)
@@ -908,9 +2048,7 @@ const char *string_for_type(data_type type)
 void extractor::save_xml(const std::string& name, uint8_t *buffer, int length, uint32_t address, uint32_t entries, uint32_t mod, vector<Entry *> entryList)
 {
     std::filesystem::path filename = std::filesystem::path(_out_dir) / (name + " .tcl");
-    FILE *fp = fopen(filename.string().c_str(), "wb");
-    if (!fp)
-        abort();
+    std::string text;
 
     const char *tcl_header = "big_endian\n\
 section \"Header\" {\n\
@@ -936,30 +2074,25 @@ section \"Header\" {\n\
     const char *tcl_block_end = "}\n";
     char tcl_buffer[256] = "";
     
-    if (fwrite(tcl_header, strlen(tcl_header), 1, fp) != 1)
-        abort();
+    text += tcl_header;
     
     int tcl_pos = 24;
     if (address - tcl_pos > 0)
     {
         snprintf(tcl_buffer, 256, "bytes %d\n", address - tcl_pos);
-        if (fwrite(tcl_buffer, strlen(tcl_buffer), 1, fp) != 1)
-            abort();
+        text += tcl_buffer;
     }
     
     snprintf(tcl_buffer, 256, "section \"Address Block\" {\n");
-    if (fwrite(tcl_buffer, strlen(tcl_buffer), 1, fp) != 1)
-        abort();
+    text += tcl_buffer;
 
     for (int i = 0; i < entries; i ++)
     {
         snprintf(tcl_buffer, 256, "    # %d...%d : dword\n    uint32 \"entry %.3d address\"\n", address + i * 4, address + i * 4 + 3, i);
-        if (fwrite(tcl_buffer, strlen(tcl_buffer), 1, fp) != 1)
-            abort();
+        text += tcl_buffer;
     }
 
-    if (fwrite(tcl_block_end, strlen(tcl_block_end), 1, fp) != 1)
-        abort();
+    text += tcl_block_end;
     
     tcl_pos = (address + entries * 4);
     
@@ -985,15 +2118,13 @@ section \"Header\" {\n\
     if (minloc - tcl_pos > 0)
     {
         snprintf(tcl_buffer, 256, "bytes %d\n", minloc - tcl_pos);
-        if (fwrite(tcl_buffer, strlen(tcl_buffer), 1, fp) != 1)
-            abort();
+        text += tcl_buffer;
     }
     
     tcl_pos = minloc;
 
     snprintf(tcl_buffer, 256, "section \"Assets Block\" {\n");
-    if (fwrite(tcl_buffer, strlen(tcl_buffer), 1, fp) != 1)
-        abort();
+    text += tcl_buffer;
     
     for (auto it = loc_map.begin(); it != loc_map.end(); it++)
     {
@@ -1004,7 +2135,7 @@ section \"Header\" {\n\
 
         location = position + 2 + value;
         
-        if (value > 0 && location < length)
+        if (value > 0 && location + 4 <= length)
         {
             int as_size = asset_size(buffer + location - 2);
             
@@ -1013,34 +2144,23 @@ section \"Header\" {\n\
             if ((int)(location - 2ul) - tcl_pos > 0)
             {
                 snprintf(tcl_buffer, 256, "    bytes %d\n", (location - 2) - tcl_pos);
-                if (fwrite(tcl_buffer, strlen(tcl_buffer), 1, fp) != 1)
-                    abort();
+                text += tcl_buffer;
             }
            
             tcl_pos = location + as_size;
             
             snprintf(tcl_buffer, 256, "    # %d...%d : bytes\n    hex %d \"entry %.3d %s\"\n", location - 2, location + as_size, as_size + 2, i, string_for_type(entry->type));
-            if (fwrite(tcl_buffer, strlen(tcl_buffer), 1, fp) != 1)
-                abort();
+            text += tcl_buffer;
         }
     }
     
-    if (fwrite(tcl_block_end, strlen(tcl_block_end), 1, fp) != 1)
-        abort();
+    text += tcl_block_end;
     
-    fclose(fp);
+    _writer.write(filename, vector<uint8_t>(text.begin(), text.end()));
 }
 
-u8 tfibo[16] = {
-    0xDE, 0xEB, 0xF3, 0xF8,
-    0xFB, 0xFD, 0xFE, 0xFF,
-    0x01, 0x02, 0x03, 0x05,
-    0x08, 0x0D, 0x15, 0x22 };
-
 void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int length, uint32_t etype, vector<uint8_t *> *pal_overrides)
 {
-    uint32_t value = 0;
-    uint32_t location = 0;
     uint32_t address = 0;
     uint32_t entries = 0;
     uint32_t mod = 0;
@@ -1055,21 +2175,123 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
     {
         return;
     }
+    
+    extract_assets(name, buffer, length, address, entries, mod, etype, pal_overrides);
+}
+
+void extractor::extract_assets(const std::string& name, uint8_t *buffer, int length, uint32_t address, uint32_t entries, uint32_t mod, uint32_t etype, vector<uint8_t *> *pal_overrides)
+{
+    uint32_t value = 0;
+    uint32_t location = 0;
 
     // identify known types and save them
     // (for the moment bitmaps, rectangles, palettes, draw commands, samples and fli videos are recognized)
     
     int width;
     int height;
-    int h0;
     int h1;
 
     uint8_t *active_pal = _override_pal ? _override_pal : _default_pal;
     
     Buffer script(buffer, length);
     set_palette(script, address, entries);
+    
+    // NOTE: over the memory budget videos, samples and patterns are decoded only when their turn
+    // comes, otherwise all entries are decoded up front; either way they go once they are written
+    
+    bool streaming = false;
+    if (_mem_limit)
+    {
+        uint64_t estimate = footprint(buffer, length, address, entries, mod);
+        streaming = estimate > _mem_limit;
+        if (streaming)
+            cout << "Estimated " << std::dec << (estimate >> 20) << " MB decoded, over budget, decoding on demand" << endl;
+    }
+    
+    if (_pack && _list_only == false)
+        _packer.begin_script(_out_dir, name, _platform);
 
     vector<Entry *> entryList;
+    Entry unknown_entry;
+    
+    struct sample_job {
+        
+        Entry *entry;
+        int rate;
+        bool is_packed;
+        std::filesystem::path filename;
+    };
+    
+    vector<sample_job> transcode_jobs;
+    uint64_t transcode_bytes = 0;
+    
+    // samples to 16 bit, all at once, or whenever they take too much of the budget
+    
+    auto transcode = [&]() {
+        
+        utils::parallel_for(transcode_jobs.size(), [&](size_t j) {
+            
+            sample_job& job = transcode_jobs[j];
+            Buffer& sample = job.entry->buffer;
+            
+            std::vector<int16_t> pcm;
+            audio::resample(sample.data, sample.size, job.is_packed == false && audio::is_signed(sample.data, sample.size), job.rate, _sample_rate, pcm);
+            
+            wavfile_header_t header = wav_header_for(_sample_rate, (int32_t)pcm.size(), 16);
+            vector<uint8_t> wav((uint8_t *)&header, (uint8_t *)(&header + 1));
+            wav.insert(wav.end(), (uint8_t *)pcm.data(), (uint8_t *)(pcm.data() + pcm.size()));
+            _writer.write(job.filename, std::move(wav));
+            release_entry(job.entry);
+        });
+        
+        transcode_jobs.clear();
+        transcode_bytes = 0;
+    };
+    vector<AtlasSprite> atlas_sprites;
+    
+    // consecutive composites and equally sized sprites are collected into one animated PNG (-a)
+    
+    struct animation {
+        
+        std::unique_ptr<apng_writer> writer;
+        std::string suffix;
+        data_type type;
+        int width;
+        int height;
+        uint8_t *palette;
+        int clear;
+        int first;
+        int last;
+    } run;
+    
+    auto flush_run = [&]() {
+        
+        if (run.writer)
+        {
+            std::string range = std::to_string(run.first) + (run.last > run.first ? "-" + std::to_string(run.last) : "");
+            run.writer->save((_out_dir / (name + " " + range + run.suffix + ".png")).string().c_str());
+            run.writer.reset();
+        }
+    };
+    
+    auto add_frame = [&](int i, data_type type, int w, int h, int bpp, uint8_t *palette, int clear, const uint8_t *pixels, const std::string& suffix) {
+        
+        if (!run.writer || run.type != type || run.width != w || run.height != h || run.palette != palette || run.clear != clear || run.last + 1 != i)
+        {
+            flush_run();
+            run.writer = std::make_unique<apng_writer>(w, h, bpp, palette, clear);
+            run.suffix = suffix;
+            run.type = type;
+            run.width = w;
+            run.height = h;
+            run.palette = palette;
+            run.clear = clear;
+            run.first = i;
+        }
+        
+        run.writer->add_frame(pixels);
+        run.last = i;
+    };
 
     for (int i = 0; i < entries; i ++)
     {
@@ -1081,6 +2303,9 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
         location = position + 2 + value;
         if (value > 0 && location < length)
         {
+            if (streaming && location >= 2 && is_bulk(mod + buffer[location - 2]))
+                continue;
+            
             entryList[i] = get_entry_data(script, mod, address, entries, i);
         }
     }
@@ -1091,15 +2316,17 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
         value = read4b(buffer + position);
 
         location = position + 2 + value;
-        if (value > 0 && location < length)
+        if (value > 0 && location >= 2 && location < length)
         {
             printf("Entry %d [0x%.6x => 0x%.6x]: ", i, position, location);
 
-            h0 = buffer[location - 2];
             h1 = buffer[location - 1];
             
-            active_pal = pal_overrides && pal_overrides->size() > i && (*pal_overrides)[i] ? (*pal_overrides)[i] : _override_pal ? _override_pal : _default_pal;
+            active_pal = palette_for(i, pal_overrides, _override_pal ? _override_pal : _default_pal);
 
+            if (entryList[i] == NULL)
+                entryList[i] = get_entry_data(script, mod, address, entries, i);
+            
             Entry *entry = entryList[i];
             switch (entry->type)
             {
@@ -1136,20 +2363,59 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
                     {
                         std::filesystem::path out = _out_dir / (name + " " + std::to_string(i) + ".png");
                         
-                        if (_force_tc)
+                        int clear = -1;
+                        if (entry->type == data_type::image4)
                         {
-                            uint8_t *data = new uint8_t[width * height * 4];
-                            
-                            int clear = -1;
-                            if (entry->type == data_type::image4)
-                            {
-                                clear = buffer[location + 5] + buffer[location + 4];
-                            }
+                            clear = buffer[location + 5] + buffer[location + 4];
+                        }
+                        
+                        if (entry->type == data_type::image8)
+                        {
+                            clear = buffer[location + 5];
+                        }
+                        
+                        if (_pack)
+                        {
+                            uint16_t palette = _packer.add_palette(active_pal, data_type::palette8);
+                            _packer.add(i, entry->type, entry->buffer.data, width * height, palette, width, height, clear);
+                        }
+                        
+                        vector<uint32_t> rgba;
+                        if (_tile_size || _phash_distance >= 0)
+                        {
+                            vector<uint32_t> colors(256);
+                            blit::expand_palette(active_pal, colors.data());
                             
-                            if (entry->type == data_type::image8)
+                            rgba.resize(width * height);
+                            for (int y = 0; y < height; y++)
                             {
-                                clear = buffer[location + 5];
+                                blit::row32(entry->buffer.data + y * width, rgba.data() + y * width, width, clear, false, colors.data());
                             }
+                        }
+                        
+                        if (_phash_distance >= 0)
+                        {
+                            _phashes.push_back({ phash::dhash(rgba.data(), width, height), string_for_platform(_platform), name + " " + std::to_string(i) });
+                        }
+                        
+                        if (_tile_size && width >= _tile_size && height >= _tile_size)
+                        {
+                            TileMap map = { name + " " + std::to_string(i), width, height, {} };
+                            _tiles.add(rgba.data(), width, height, map.cells);
+                            _tilemaps.push_back(std::move(map));
+                        }
+                        else if (_atlas)
+                        {
+                            AtlasSprite sprite = {};
+                            sprite.index = i;
+                            sprite.entry = entry;
+                            sprite.palette = active_pal;
+                            sprite.clear = clear;
+                            atlas_sprites.push_back(sprite);
+                        }
+                        else if (_force_tc)
+                        {
+                            vector<uint8_t> data(width * height * 4);
                             
                             int to = 0;
                             for (int x = 0; x < width * height; x++)
@@ -1161,41 +2427,63 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
                                 data[to++] = index == clear ? 0x00 : 0xff;
                             }
                             
-                            write_png_file(out.string().c_str(), width, height, PNG_COLOR_TYPE_RGBA, 8, data);
+                            if (_animate)
+                                add_frame(i, entry->type, width, height, 4, NULL, -1, data.data(), "");
+                            else
+                                write_png_file(out.string().c_str(), width, height, PNG_COLOR_TYPE_RGBA, 8, data.data());
+                        }
+                        else if (_animate)
+                        {
+                            add_frame(i, entry->type, width, height, 1, active_pal, _transparent ? clear : -1, entry->buffer.data, "");
                         }
                         else
                         {
-                            write_png_file(out.string().c_str(), width, height, PNG_COLOR_TYPE_PALETTE, 8, entry->buffer.data, active_pal);
+                            write_png_variants(out, width, height, entry->buffer.data, active_pal, _transparent ? clear : -1);
                         }
                     }
                     break;
                 }
                 case data_type::video:
                 {
+                    // parse_entry made sure header is there, it is little endian like all of FLI
+                    
                     uint32_t size = read4b(buffer + location);
-                    char *fliname = (char *)&buffer[location + 4];
-                    uint32_t size2 = (*(uint32_t *)(&buffer[location + 30]));
-                    uint16_t frames = (*(uint16_t *)(&buffer[location + 36]));
+                    std::string fliname((char *)&buffer[location + 4], strnlen((char *)&buffer[location + 4], 26));
+                    uint32_t size2 = decode::byte_order<true>::read4b(buffer + location + 30);
+                    uint16_t frames = decode::byte_order<true>::read2b(buffer + location + 36);
                     
-                    log_data(buffer, location - 2, 2, 4, "FLI video (%s) %d bytes [size: %d frames: %d]", fliname, size, size2, frames);
+                    log_data(buffer, location - 2, 2, 4, "FLI video (%s) %d bytes [size: %d frames: %d]", fliname.c_str(), size, size2, frames);
                     
                     if (_list_only == false && etype & ex_video)
                     {
                         write_buffer(std::filesystem::path(_out_dir) / (name + " " + std::to_string(i) + ".fli"), entry->buffer);
+                        
+                        if (_pack)
+                            _packer.add(i, data_type::video, entry->buffer.data, entry->buffer.size);
+                        
+                        if (_convert_video && entry->video)
+                        {
+                            write_fli_frames(name + " " + std::to_string(i), *entry->video);
+                        }
                     }
+                    
+                    release_entry(entry);
                     break;
                 }
                 case data_type::composite:
                 {
                     log_data(buffer, location - 2, 2, 0, "%d draw instructions ", h1);
                     
+                    std::vector<DrawCall> calls(h1);
+                    _codec.draw_calls(buffer + location, h1, calls.data());
+                    
                     for (int b = 0; b < h1; b++)
                     {
-                        uint8_t cmd = buffer[b * 8 + location + (_is_little_endian ? 1 : 0)];
-                        uint8_t index = buffer[b * 8 + location + (_is_little_endian ? 0 : 1)];
-                        int16_t x = read2b(buffer + b * 8 + location + 2);
-                        int16_t o = read2b(buffer + b * 8 + location + 4);
-                        int16_t y = read2b(buffer + b * 8 + location + 6);
+                        uint8_t cmd = calls[b].cmd;
+                        uint8_t index = calls[b].index;
+                        int16_t x = calls[b].x;
+                        int16_t o = calls[b].order;
+                        int16_t y = calls[b].y;
                         
                         // cmd
                         // 0        = draw
@@ -1205,11 +2493,11 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
                         // 134      = ???
                         // 34       = ???
 
-                        Entry *e = entryList[index];
+                        Entry *e = index < entries && entryList[index] ? entryList[index] : &unknown_entry;
                         if (e->type != none && e->type != unknown)
                         {
-                            width = read2b(script.data + e->position) + 1;
-                            height = read2b(script.data + e->position + 2) + 1;
+                            width = e->width;
+                            height = e->height;
                             
                             cout << "  cmd: " << std::dec << std::setw(3) << (int)cmd << " index: " << std::dec << std::setw(3) << (int)index << " type: " << string_for_type(e->type) << " x " << std::dec << x << " y " << std::dec << y  << " w " << std::dec << width << " h " << std::dec << height << " order: " << std::dec << o << endl;
                         }
@@ -1219,30 +2507,41 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
                         }
                     }
                     
-                    // TODO: do composition in 32 bit
                     if (_list_only == false && etype & ex_draw)
                     {
                         std::filesystem::path out = _out_dir / (name + " " + std::to_string(i) + " (composite)" + ".png");
+                        
+                        vector<Blit> blits;
+                        layout_composite(script, mod, address, entries, location, h1, blits);
 
                         if (_force_tc)
                         {
-                            uint8_t *data = new uint8_t[composite_width * composite_height * 4];
-                    
-                            int to = 0;
-                            for (int x = 0; x < composite_width * composite_height; x++)
-                            {
-                                int index = entry->buffer.data[x];
-                                data[to++] = active_pal[index * 3 + 0];
-                                data[to++] = active_pal[index * 3 + 1];
-                                data[to++] = active_pal[index * 3 + 2];
-                                data[to++] = 0xff;
-                            }
-                    
-                            write_png_file(out.string().c_str(), composite_width, composite_height, PNG_COLOR_TYPE_RGBA, 8, data);
+                            const uint32_t *data = render_composite(blits, _layers32, active_pal, pal_overrides);
+                            if (_phash_distance >= 0)
+                                _phashes.push_back({ phash::dhash(data, composite_width, composite_height), string_for_platform(_platform), name + " " + std::to_string(i) + " (composite)" });
+                            
+                            if (_animate)
+                                add_frame(i, data_type::composite, composite_width, composite_height, 4, NULL, -1, (const uint8_t *)data, " (composite)");
+                            else
+                                write_png_file(out.string().c_str(), composite_width, composite_height, PNG_COLOR_TYPE_RGBA, 8, (uint8_t *)data);
                         }
                         else
                         {
-                            write_png_file(out.string().c_str(), composite_width, composite_height, PNG_COLOR_TYPE_PALETTE, 8, entry->buffer.data, active_pal);
+                            const uint8_t *data = render_composite(blits, _layers8, NULL, NULL);
+                            if (_phash_distance >= 0)
+                            {
+                                vector<uint32_t> colors(256);
+                                blit::expand_palette(active_pal, colors.data());
+                                
+                                vector<uint32_t> rgba(composite_width * composite_height);
+                                blit::row32(data, rgba.data(), (int)rgba.size(), -1, false, colors.data());
+                                _phashes.push_back({ phash::dhash(rgba.data(), composite_width, composite_height), string_for_platform(_platform), name + " " + std::to_string(i) + " (composite)" });
+                            }
+                            
+                            if (_animate)
+                                add_frame(i, data_type::composite, composite_width, composite_height, 1, active_pal, -1, data, " (composite)");
+                            else
+                                write_png_variants(out, composite_width, composite_height, (uint8_t *)data, active_pal);
                         }
                     }
                     break;
@@ -1261,17 +2560,11 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
                     {
                         std::filesystem::path filename = std::filesystem::path(_out_dir) / (name + " " + std::to_string(i) + ".pattern");
                         
-                        FILE *fp = fopen(filename.string().c_str(), "wb");
-                        if (!fp)
-                            abort();
-                        
-                        if (fwrite(entry->buffer.data, entry->buffer.size, 1, fp) != 1)
-                            abort();
-                        
-                        fclose(fp);
+                        _writer.write(filename, vector<uint8_t>(entry->buffer.data, entry->buffer.data + entry->buffer.size));
                     }
                     
                     log_data(buffer, location - 2, 2, 4, "Possible mod pattern? (%d bytes)", entry->buffer.size);
+                    release_entry(entry);
                     break;
                 }
                 case data_type::sample:
@@ -1282,92 +2575,60 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
                     
                     int len = entry->buffer.size;
                     
-                    u8 *sample = buffer + location - 2;
-                    if (sample[6] == 1/* && script->type & 1*/)
-                    {
-                        s8 temp[1024 * 1024];
-                        
-                        u32 fulllen = read4b(sample + 2);
-                        s8 *smpdata = (s8 *)entry->buffer.data;
-
-                        s32 length = ((fulllen - 0x10) >> 1);
-                        memcpy(temp, smpdata, length);
-
-                        s8 newval = (u8)temp[0];
-                        s8 *smpptr0 = (s8 *)entry->buffer.data + 1;
-                        s8 *smpptr2 = smpptr0;
-                        smpptr2[-1] = newval;
-
-                        for (int i = 1; i < length; i++)
-                        {
-                            smpptr2 = smpptr0;
-                            smpptr2[0] = (newval += (s8)tfibo[(u8)temp[i] >> 4]);
-                            smpptr2[1] = (newval += (s8)tfibo[(u8)temp[i] & 0xf]);
-                            smpptr0 = smpptr2 + 2;
-                        }
-
-                        smpptr2[0] = 0;
-                        smpptr2[1] = 0;
-                    }
-
                     if (_list_only == false && etype & ex_sound)
                     {
                         std::filesystem::path filename = std::filesystem::path(_out_dir) / (name + " " + std::to_string(i) + ".wav");
                         
-                        FILE *fp = fopen(filename.string().c_str(), "wb");
-                        if (!fp)
-                            abort();
+                        // NOTE: fibonacci packed samples are already decoded as unsigned
                         
-                        int res = write_wav_header(fp, freq * 1000, len);
-                        if (res)
-                            abort();
+                        bool is_packed = buffer[location + 4] == 1;
                         
-                        // try to find out if sample is signed or unsigned
-                        
-                        int smp_signed = 0;
-                        int smp_unsigned = 0;
-                        
-                        for (int b = 0; b < len; b++)
+                        if (_pack)
                         {
-                            uint8_t tui = entry->buffer.data[b];
-                            uint8_t tsi = entry->buffer.data[b] ^ 0x80;
+                            vector<uint8_t> pcm(entry->buffer.data, entry->buffer.data + len);
+                            if (is_packed == false && audio::is_signed(pcm.data(), len))
+                                audio::flip_sign(pcm.data(), len);
                             
-                            if (tui != tsi)
-                            {
-                                if (tui > tsi)
-                                {
-                                    smp_unsigned++;
-                                }
-                                else
-                                {
-                                    smp_signed++;
-                                }
-                            }
+                            _packer.add(i, data_type::sample, pcm.data(), len, PACK_NONE, 0, 0, -1, freq * 1000);
                         }
                         
-                        if (smp_unsigned > smp_signed)
+                        if (_sample_rate)
+                        {
+                            // transcoded later (16 bit output is 2x the sample, times rate ratio)
+                            transcode_jobs.push_back({ entry, freq * 1000, is_packed, filename });
+                            transcode_bytes += (uint64_t)len * (1 + 2 * _sample_rate / (freq * 1000));
+                            
+                            if (_mem_limit && transcode_bytes > _mem_limit / 4)
+                                transcode();
+                        }
+                        else
                         {
-                            // convert from signed to unsigned PCM
-                            // NOTE: wav doesn't support signed 8 bit sample
+                            // try to find out if sample is signed or unsigned
                             
-                            for (int b = 0; b < len; b++)
+                            if (is_packed == false && audio::is_signed(entry->buffer.data, len))
                             {
-                                entry->buffer.data[b]  ^= 0x80;
+                                // convert from signed to unsigned PCM
+                                // NOTE: wav doesn't support signed 8 bit sample
+                            
+                                audio::flip_sign(entry->buffer.data, len);
                             }
+                            
+                            wavfile_header_t header = wav_header_for(freq * 1000, len);
+                            vector<uint8_t> wav((uint8_t *)&header, (uint8_t *)(&header + 1));
+                            wav.insert(wav.end(), entry->buffer.data, entry->buffer.data + len);
+                            _writer.write(filename, std::move(wav));
                         }
-                        
-                        if (fwrite(entry->buffer.data, len, 1, fp) != 1)
-                            abort();
-                        
-                        fclose(fp);
                     }
                     
                     log_data(buffer, location - 2, 2, 4, "PCM sample %d bytes %d Hz ", len, freq);
+                    
+                    if (transcode_jobs.empty() || transcode_jobs.back().entry != entry)
+                        release_entry(entry);
                     break;
                 }
                 default:
                 {
-                    log_data(buffer, location - 2, 2, 8, "unknown ");
+                    log_data(buffer, location - 2, 2, std::min(8, length - (int)location), "unknown ");
                     break;
                 }
             }
@@ -1378,6 +2639,11 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
         }
     }
 
+    flush_run();
+    write_atlas(name, atlas_sprites);
+    
+    transcode();
+    
     // xml
     
     save_xml(name, buffer, length, address, entries, mod, entryList);
@@ -1394,4 +2660,7 @@ void extractor::extract_buffer(const std::string& name, uint8_t *buffer, int len
     }
 
     _entry_map.clear();
+    
+    _layers8 = {};
+    _layers32 = {};
 }
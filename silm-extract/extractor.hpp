@@ -10,11 +10,17 @@
 
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <png.h>
 #include <stdio.h>
 #include <string>
 #include <vector>
 
+#include "file_writer.hpp"
+#include "fli.hpp"
+#include "pack.hpp"
+#include "tiles.hpp"
+
 enum alis_platform {
 
     atari,
@@ -58,6 +64,12 @@ enum extract_type {
     ex_none        = 0x0
 };
 
+enum image_format {
+    
+    format_png,
+    format_qoi
+};
+
 struct Buffer {
   
     Buffer() { data = NULL; size = 0; }
@@ -71,12 +83,112 @@ struct Buffer {
 
 struct Entry {
   
-    Entry() { type = none; buffer = Buffer(); };
-    Entry(data_type t, uint32_t p, const Buffer& b) { type = t; position = p; buffer = b; };
+    Entry() { type = none; width = 0; height = 0; buffer = Buffer(); };
+    Entry(data_type t, uint32_t p, const Buffer& b, int w = 0, int h = 0) { type = t; position = p; buffer = b; width = w; height = h; };
 
     data_type type;
     uint32_t position;
+    int width;
+    int height;
     Buffer buffer;
+    std::shared_ptr<fli_decoder> video;     // seek index over buffer, videos only
+};
+
+struct DrawCall {
+    
+    uint8_t cmd;
+    uint8_t index;
+    int16_t x;
+    int16_t order;
+    int16_t y;
+};
+
+struct Bounds {
+    
+    int left;
+    int top;
+    int right;          // exclusive
+    int bottom;         // exclusive
+};
+
+// one draw call of a composite, placed and clipped to screen
+struct Blit {
+    
+    uint32_t index;     // entry index
+    Entry *entry;
+    uint8_t cmd;
+    int x;              // sprite origin on screen
+    int y;
+    int clear;          // transparent color, -1 for none
+    Bounds area;        // visible part on screen
+};
+
+// Canvas of the last saved composite and the blits it was drawn from. Composites of
+// one script mostly share background and sprites, so only what differs is redrawn.
+template <typename pixel>
+struct LayerStack {
+    
+    vector<Blit> blits;
+    vector<pixel> canvas;
+    uint8_t *palette;
+    std::map<uint8_t *, vector<uint32_t>> colors;
+};
+
+// extra palette sprites are saved with (see write_png_variants)
+struct PaletteVariant {
+    
+    std::string name;
+    uint8_t *palette;
+};
+
+// bitmap placed on an atlas sheet (see write_atlas)
+struct AtlasSprite {
+    
+    int index;          // entry index
+    Entry *entry;
+    uint8_t *palette;
+    int clear;          // transparent color, -1 for none
+    int left, top;      // trimmed part of bitmap
+    int width, height;
+    int sheet;          // -1 if nothing is left after trimming
+    int x, y;           // position on sheet
+};
+
+// tile indices of one bitmap (see write_tiles)
+struct TileMap {
+    
+    std::string name;
+    int width;          // bitmap size in pixels
+    int height;
+    vector<uint32_t> cells;
+};
+
+// perceptual hash of a bitmap or composite (see write_phash)
+struct PerceptualHash {
+    
+    uint64_t hash;
+    std::string platform;
+    std::string asset;
+};
+
+// address table found in a raw dump (see scan_tables)
+struct AssetTable {
+    
+    uint32_t address;
+    uint32_t entries;
+    uint32_t mod;           // 0x100 for sound tables
+};
+
+// format specific decoders, picked once per script (see decode.hpp)
+struct Codec {
+    
+    alis_platform platform;
+    data_type bitmap_type;   // type of 0x00 / 0x02 bitmaps
+    int bitmap_ratio;        // pixels per byte of 0x00 / 0x02 bitmaps
+    
+    void (*bitmap)(const uint8_t *src, uint8_t *dst, int pixels);
+    void (*palette4)(const uint8_t *src, uint8_t *dst);
+    void (*draw_calls)(const uint8_t *src, int count, DrawCall *calls);
 };
 
 
@@ -90,25 +202,81 @@ public:
 
     void set_palette(uint8_t *palette);
     void set_out_dir(const path& output);
+    void set_sample_rate(int rate);
+    void set_convert_video(bool convert);
+    void set_animate(bool animate);
+    void set_transparent(bool transparent);
+    void set_palette_variants(const vector<PaletteVariant>& variants);
+    void set_image_format(image_format format);
+    void set_atlas(bool atlas);
+    void set_tiles(int size);
+    void set_phash(int distance);
+    void set_pack(bool pack);
+    void set_scan(const std::string& ext);
+    void set_shard(int index, int count);
+    void set_mem_limit(uint64_t bytes);
     
-    bool is_script(const path& file);
+    static bool is_script(const path& file);
     
     void extract_dir(const path& path, uint32_t etype = ex_everything);
     void extract_file(const path& file, uint32_t etype = ex_everything, vector<uint8_t *> *pal_overrides = NULL);
     void extract_buffer(const std::string& name, uint8_t *buffer, int length, uint32_t etype, vector<uint8_t *> *pal_overrides = NULL);
+    void watch(const path& input, uint32_t etype = ex_everything);
+    void merge_shards(const path& dir);
 
 private:
 
+    void extract_disk(const path& file, uint32_t etype);
+    void extract_zip(const path& file, uint32_t etype);
+    void extract_script(const std::string& name, const path& file, uint8_t *buffer, int length, uint32_t etype, vector<uint8_t *> *pal_overrides, bool in_archive);
+    void extract_dump(const path& file, uint32_t etype);
+    void extract_assets(const std::string& name, uint8_t *buffer, int length, uint32_t address, uint32_t entries, uint32_t mod, uint32_t etype, vector<uint8_t *> *pal_overrides);
+    void write_collected(const std::string& name);
+    
+    bool in_shard(const path& relative);
+    std::string shard_suffix();
+    
+    int find_header(const uint8_t *buffer, int length, uint32_t address);
+    uint32_t check_table(const uint8_t *buffer, int length, uint32_t address, uint32_t mod, uint64_t& bytes);
+    void scan_tables(const uint8_t *buffer, int length, vector<AssetTable>& tables);
+    
     bool find_assets(const uint8_t *buffer, int length, uint32_t& address, uint32_t& entries, uint32_t& mod);
 
     void set_palette(Buffer& script, uint32_t address, uint32_t entries);
 
     Entry *get_entry_data(Buffer& script, uint32_t mod, uint32_t address, uint32_t entries, uint32_t index);
+    void release_entry(Entry *entry);
+    static bool is_bulk(int h0);
+    uint64_t footprint(const uint8_t *buffer, int length, uint32_t address, uint32_t entries, uint32_t mod);
+    
+    template <bool little_endian>
+    Entry *parse_entry(Buffer& script, uint32_t mod, uint32_t address, uint32_t index);
+
+    void layout_composite(Buffer& script, uint32_t mod, uint32_t address, uint32_t entries, uint32_t location, int count, vector<Blit>& blits);
+    
+    template <typename pixel>
+    const pixel *render_composite(const vector<Blit>& blits, LayerStack<pixel>& stack, uint8_t *palette, vector<uint8_t *> *pal_overrides);
+    
+    void draw_blit(const Blit& b, const Bounds& clip, uint8_t *data, const uint32_t *colors);
+    void draw_blit(const Blit& b, const Bounds& clip, uint32_t *data, const uint32_t *colors);
+    
+    uint8_t *palette_for(uint32_t index, vector<uint8_t *> *pal_overrides, uint8_t *fallback);
 
     void write_buffer(const std::filesystem::path& path, const Buffer& buffer);
-    void write_png_file(const char *filename, int width, int height, png_byte color_type, png_byte bit_depth, uint8_t *data, uint8_t *palette = NULL);
+    void write_fli_frames(const std::string& name, fli_decoder& fli);
+    void encode_png(std::vector<uint8_t>& out, int width, int height, png_byte color_type, png_byte bit_depth, uint8_t *data, uint8_t *palette = NULL, int clear = -1);
+    void write_png_file(const char *filename, int width, int height, png_byte color_type, png_byte bit_depth, uint8_t *data, uint8_t *palette = NULL, int clear = -1);
+    void write_png_variants(const std::filesystem::path& path, int width, int height, uint8_t *data, uint8_t *palette, int clear = -1);
+    void write_atlas(const std::string& name, vector<AtlasSprite>& sprites);
+    void write_tiles(const std::string& name);
+    void write_phash();
+    void load_phash(const path& catalog, vector<PerceptualHash>& hashes);
+    void merge_phash(vector<PerceptualHash>& all, const vector<PerceptualHash>& fresh);
+    void save_phash(const path& catalog, const vector<PerceptualHash>& all);
+    void write_phash_matches(const vector<PerceptualHash>& all);
+    void write_qoi_file(std::filesystem::path path, int width, int height, uint8_t *indexed, uint8_t *palette, int clear, uint8_t *rgba = NULL);
     
-    int asset_size(const uint8_t *buffer);
+    int asset_size(const uint8_t *buffer, uint32_t mod = 0);
 
     void save_xml(const std::string& name, uint8_t *buffer, int length, uint32_t address, uint32_t entries, uint32_t mod, vector<Entry *> entryList);
 
@@ -116,7 +284,6 @@ private:
     uint32_t read4b(const uint8_t *buffer);
 
     alis_platform _platform;
-    std::string _platform_ext;
     
     std::filesystem::path _out_dir;
     
@@ -128,9 +295,35 @@ private:
     bool _force_tc;
     bool _list_only;
     
+    int _sample_rate; // 0 keeps original 8 bit samples
+    bool _convert_video;
+    bool _animate;
+    bool _transparent; // tRNS for clear color of indexed sprites
+    vector<PaletteVariant> _variants;
+    image_format _format;
+    bool _atlas;
+    int _tile_size; // 0 saves bitmaps whole
+    tile_set _tiles;
+    vector<TileMap> _tilemaps;
+    int _phash_distance; // -1 for no perceptual hashes
+    vector<PerceptualHash> _phashes;
+    bool _pack;
+    pack_writer _packer;
+    file_writer _writer; // every output file but animated PNGs and packs
+    std::string _scan; // script extension of raw dumps to scan, empty for scripts
+    int _shard_index;
+    int _shard_count; // 0 extracts everything
+    uint64_t _mem_limit; // bytes, 0 for no budget
+    
+    bool _in_dir; // tileset and hashes are written once for a whole directory
+    
     bool _is_little_endian;
     bool _is_packed;
     int8_t _type;
+    Codec _codec;
+    
+    LayerStack<uint8_t> _layers8;
+    LayerStack<uint32_t> _layers32;
 
     std::map<int, Entry *> _entry_map;
 };
@@ -0,0 +1,364 @@
+//
+//  file_writer.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "file_writer.hpp"
+#include "utils.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(FILE_WRITER_URING)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// files per batch, each takes 4 submissions and one fixed file slot
+static const size_t batch_files = 32;
+static const size_t batch_bytes = 8 << 20;
+
+file_writer::file_writer()
+{
+    _bytes = 0;
+
+#if defined(FILE_WRITER_URING)
+    _ring = -1;
+    _sq_map = _cq_map = _sqes = NULL;
+    
+    if (setup() == false && _ring >= 0)
+    {
+        close(_ring);
+        _ring = -1;
+    }
+#endif
+}
+
+file_writer::~file_writer()
+{
+    flush();
+
+#if defined(FILE_WRITER_URING)
+    if (_ring >= 0)
+    {
+        munmap(_sqes, _sqes_size);
+        if (_cq_map != _sq_map)
+            munmap(_cq_map, _cq_size);
+        
+        munmap(_sq_map, _sq_size);
+        close(_ring);
+    }
+    
+    for (auto& d : _dirs)
+        close(d.second);
+#endif
+}
+
+void file_writer::write(const std::filesystem::path& path, std::vector<uint8_t> data)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    
+    // NOTE: chains of one batch run concurrently, a second write of the same file has to wait
+    
+    for (const pending& p : _pending)
+    {
+        if (p.path == path)
+        {
+            submit();
+            break;
+        }
+    }
+    
+    pending file;
+    file.path = path;
+    file.name = path.filename().string();
+    file.part = file.name + ".part";
+    file.dir = -1;
+    file.data = std::move(data);
+
+#if defined(FILE_WRITER_URING)
+    if (_ring >= 0)
+        file.dir = dir_fd(path.parent_path());
+#endif
+    
+    _bytes += file.data.size();
+    _pending.push_back(std::move(file));
+    
+    if (_pending.size() >= batch_files || _bytes >= batch_bytes)
+        submit();
+}
+
+void file_writer::flush()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    submit();
+}
+
+void file_writer::write_stdio(const pending& file)
+{
+    FILE *fp = utils::open_output(file.path);
+    if (!fp)
+        abort();
+    
+    if (file.data.size() && fwrite(file.data.data(), file.data.size(), 1, fp) != 1)
+        abort();
+    
+    utils::close_output(fp, file.path);
+}
+
+#if defined(FILE_WRITER_URING)
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int ring, unsigned submit, unsigned complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, ring, submit, complete, flags, NULL, 0);
+}
+
+static int uring_register(int ring, unsigned opcode, const void *arg, unsigned count)
+{
+    return (int)syscall(__NR_io_uring_register, ring, opcode, arg, count);
+}
+
+bool file_writer::setup()
+{
+    struct io_uring_params p = {};
+    _ring = uring_setup(batch_files * 4, &p);
+    if (_ring < 0)
+        return false;
+    
+    // NOTE: direct descriptors (5.15) have no feature bit, skipping completions came
+    // with 5.17 and stands in for them; a kernel without them would fail every chain
+    
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0 || (p.features & IORING_FEAT_CQE_SKIP) == 0)
+        return false;
+    
+    std::vector<uint8_t> probe(sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op), 0);
+    if (uring_register(_ring, IORING_REGISTER_PROBE, probe.data(), 256) < 0)
+        return false;
+    
+    struct io_uring_probe *ops = (struct io_uring_probe *)probe.data();
+    for (int op : { IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE, IORING_OP_RENAMEAT })
+    {
+        if (op > ops->last_op || (ops->ops[op].flags & IO_URING_OP_SUPPORTED) == 0)
+            return false;
+    }
+    
+    // empty fixed file table, files are opened straight into a slot
+    std::vector<int> slots(batch_files, -1);
+    if (uring_register(_ring, IORING_REGISTER_FILES, slots.data(), (unsigned)slots.size()) < 0)
+        return false;
+    
+    _sq_size = std::max(p.sq_off.array + p.sq_entries * sizeof(unsigned), p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe));
+    _cq_size = _sq_size;
+    _sq_map = mmap(NULL, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQ_RING);
+    if (_sq_map == MAP_FAILED)
+    {
+        _sq_map = NULL;
+        return false;
+    }
+    
+    _cq_map = _sq_map;
+    
+    _sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = mmap(NULL, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ring, IORING_OFF_SQES);
+    if (_sqes == MAP_FAILED)
+    {
+        munmap(_sq_map, _sq_size);
+        _sq_map = _cq_map = _sqes = NULL;
+        return false;
+    }
+    
+    uint8_t *sq = (uint8_t *)_sq_map;
+    _sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    _sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    _sq_array = (unsigned *)(sq + p.sq_off.array);
+    
+    uint8_t *cq = (uint8_t *)_cq_map;
+    _cq_head = (unsigned *)(cq + p.cq_off.head);
+    _cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    _cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    _cqes = cq + p.cq_off.cqes;
+    
+    return true;
+}
+
+int file_writer::dir_fd(const std::filesystem::path& dir)
+{
+    std::string key = dir.empty() ? "." : dir.string();
+    
+    // NOTE: directory may have been removed and created again since (--watch), cached
+    // descriptor is only good while it still is what the path names; that is checked
+    // once per batch, not for every file
+    
+    auto it = _dirs.find(key);
+    if (it != _dirs.end() && _checked.count(key))
+        return it->second;
+    
+    _checked.insert(key);
+    
+    struct stat path_stat;
+    bool exists = stat(key.c_str(), &path_stat) == 0;
+    
+    if (it != _dirs.end())
+    {
+        struct stat fd_stat;
+        if (exists && fstat(it->second, &fd_stat) == 0 && fd_stat.st_dev == path_stat.st_dev && fd_stat.st_ino == path_stat.st_ino)
+            return it->second;
+        
+        close(it->second);
+        _dirs.erase(it);
+    }
+    
+    if (exists == false)
+        return -1;
+    
+    int fd = open(key.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0)
+        _dirs[key] = fd;
+    
+    return fd;
+}
+
+void file_writer::submit()
+{
+    _checked.clear();
+    
+    if (_pending.empty())
+        return;
+    
+    if (_ring < 0)
+    {
+        for (const pending& file : _pending)
+            write_stdio(file);
+        
+        _pending.clear();
+        _bytes = 0;
+        return;
+    }
+    
+    // one linked chain per file: open into slot, write, close slot, rename over target
+    
+    struct io_uring_sqe *sqes = (struct io_uring_sqe *)_sqes;
+    unsigned tail = *_sq_tail;
+    unsigned count = 0;
+    
+    auto next = [&](uint8_t op, size_t file, unsigned step, uint8_t flags) {
+        
+        unsigned index = tail & *_sq_mask;
+        struct io_uring_sqe *sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = op;
+        sqe->flags = flags;
+        sqe->user_data = file * 4 + step;
+        _sq_array[index] = index;
+        tail++;
+        count++;
+        return sqe;
+    };
+    
+    std::vector<char> failed(_pending.size(), 0);
+    
+    for (size_t f = 0; f < _pending.size(); f++)
+    {
+        pending& file = _pending[f];
+        if (file.dir < 0)
+        {
+            failed[f] = 1;
+            continue;
+        }
+        
+        struct io_uring_sqe *sqe = next(IORING_OP_OPENAT, f, 0, IOSQE_IO_LINK);
+        sqe->fd = file.dir;
+        sqe->addr = (uint64_t)file.part.c_str();
+        sqe->len = 0644;
+        sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;    // direct descriptors refuse O_CLOEXEC
+        sqe->file_index = (uint32_t)f + 1;
+        
+        sqe = next(IORING_OP_WRITE, f, 1, IOSQE_IO_LINK | IOSQE_FIXED_FILE);
+        sqe->fd = (int)f;
+        sqe->addr = (uint64_t)file.data.data();
+        sqe->len = (uint32_t)file.data.size();
+        sqe->off = 0;
+        
+        sqe = next(IORING_OP_CLOSE, f, 2, IOSQE_IO_LINK);
+        sqe->file_index = (uint32_t)f + 1;
+        
+        sqe = next(IORING_OP_RENAMEAT, f, 3, 0);
+        sqe->fd = file.dir;
+        sqe->addr = (uint64_t)file.part.c_str();
+        sqe->len = (uint32_t)file.dir;
+        sqe->addr2 = (uint64_t)file.name.c_str();
+    }
+    
+    __atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+    
+    unsigned submitted = 0;
+    unsigned completed = 0;
+    while (completed < count)
+    {
+        int res = uring_enter(_ring, count - submitted, 1, IORING_ENTER_GETEVENTS);
+        if (res < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            
+            abort();
+        }
+        
+        submitted += res;
+        
+        unsigned head = *_cq_head;
+        unsigned cq_tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != cq_tail; head++)
+        {
+            struct io_uring_cqe *cqe = &((struct io_uring_cqe *)_cqes)[head & *_cq_mask];
+            size_t file = cqe->user_data / 4;
+            bool is_write = cqe->user_data % 4 == 1;
+            
+            // NOTE: a short write counts as failure, it breaks the chain as well
+            
+            if (cqe->res < 0 || (is_write && (size_t)cqe->res != _pending[file].data.size()))
+                failed[file] = 1;
+            
+            completed++;
+        }
+        
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    }
+    
+    // whatever went wrong is tried once more the plain way, that one aborts on error
+    
+    for (size_t f = 0; f < _pending.size(); f++)
+    {
+        if (failed[f])
+            write_stdio(_pending[f]);
+    }
+    
+    _pending.clear();
+    _bytes = 0;
+}
+
+#else
+
+void file_writer::submit()
+{
+    for (const pending& file : _pending)
+        write_stdio(file);
+    
+    _pending.clear();
+    _bytes = 0;
+}
+
+#endif
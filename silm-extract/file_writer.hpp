@@ -0,0 +1,91 @@
+//
+//  file_writer.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef file_writer_hpp
+#define file_writer_hpp
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+    #define FILE_WRITER_URING   1
+#endif
+
+// Output files are queued and written a batch at a time. With io_uring every file
+// is one linked openat, write, close, renameat chain relative to a cached directory
+// descriptor, so a whole batch costs a single syscall. Where io_uring is missing or
+// refused (old kernel, seccomp) plain stdio is used. Either way a file is written to
+// a .part sibling and renamed when complete (see utils::open_output). Animated PNGs
+// and .pak files grow while they are written and go straight through stdio instead.
+
+class file_writer {
+
+public:
+    
+    file_writer();
+    ~file_writer();
+    
+    file_writer(const file_writer&) = delete;
+    file_writer& operator=(const file_writer&) = delete;
+    
+    // safe to call from parallel jobs, data is kept until written
+    void write(const std::filesystem::path& path, std::vector<uint8_t> data);
+    
+    // everything queued is on disk when this returns
+    void flush();
+
+private:
+    
+    struct pending {
+        
+        std::filesystem::path path;
+        std::string name;       // relative to dir
+        std::string part;
+        int dir;
+        std::vector<uint8_t> data;
+    };
+    
+    void submit();
+    void write_stdio(const pending& file);
+    
+    std::mutex _lock;
+    std::vector<pending> _pending;
+    size_t _bytes;
+
+#if defined(FILE_WRITER_URING)
+    
+    bool setup();
+    int dir_fd(const std::filesystem::path& dir);
+    
+    int _ring;
+    void *_sq_map;
+    size_t _sq_size;
+    void *_cq_map;
+    size_t _cq_size;
+    void *_sqes;
+    size_t _sqes_size;
+    
+    unsigned *_sq_tail;
+    unsigned *_sq_mask;
+    unsigned *_sq_array;
+    unsigned *_cq_head;
+    unsigned *_cq_tail;
+    unsigned *_cq_mask;
+    void *_cqes;
+    
+    std::map<std::string, int> _dirs;
+    std::set<std::string> _checked;     // dirs validated for current batch
+
+#endif
+};
+
+#endif /* file_writer_hpp */
@@ -0,0 +1,430 @@
+//
+//  fli.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "fli.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+// NOTE: FLI is a PC format, everything is little endian
+
+static inline uint16_t rd16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t rd32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// length of run that fits both into line and into chunk data
+static inline int clip(long count, long room, long avail)
+{
+    return (int)std::max(0l, std::min({ count, room, avail }));
+}
+
+fli_decoder::fli_decoder(const uint8_t *data, uint32_t size)
+{
+    _data = data;
+    _size = size;
+    
+    _valid = false;
+    _width = 0;
+    _height = 0;
+    _frames = 0;
+    _first = 128;
+    _interval = 0;
+    
+    if (size >= 128)
+    {
+        uint16_t magic = rd16(data + 4);
+        _frames = rd16(data + 6);
+        _width = rd16(data + 8);
+        _height = rd16(data + 10);
+
+        if (magic == 0xAF12)
+        {
+            // FLC knows where first frame is
+            uint32_t oframe1 = rd32(data + 80);
+            if (oframe1 >= 128 && oframe1 < size)
+                _first = oframe1;
+        }
+        
+        if (magic == 0xAF11 && _width == 0)
+        {
+            _width = 320;
+            _height = 200;
+        }
+
+        _valid = (magic == 0xAF11 || magic == 0xAF12) && _width > 0 && _height > 0 && _width <= 4096 && _height <= 4096;
+    }
+    
+    if (_valid)
+    {
+        _pixels.resize(_width * _height);
+    }
+
+    rewind();
+}
+
+void fli_decoder::rewind()
+{
+    _at = _first;
+    _frame = 0;
+
+    std::fill(_pixels.begin(), _pixels.end(), 0);
+    memset(_palette, 0, sizeof(_palette));
+}
+
+bool fli_decoder::decode_next()
+{
+    // NOTE: file contains one more "ring" frame (back to first one) we are not interested in
+    
+    while (_valid && _frame < _frames && _at + 16 <= _size)
+    {
+        uint32_t size = rd32(_data + _at);
+        uint16_t type = rd16(_data + _at + 4);
+        
+        if (size < 16 || size > _size - _at)
+            return false;
+
+        if (type == fli_frame)
+        {
+            if (_frame == (int)_positions.size())
+                _positions.push_back(_at);
+            
+            const uint8_t *end = _data + _at + size;
+            const uint8_t *p = _data + _at + 16;
+            
+            int chunks = rd16(_data + _at + 6);
+            for (int c = 0; c < chunks && p + 6 <= end; c++)
+            {
+                uint32_t csize = rd32(p);
+                if (csize < 6 || csize > end - p)
+                    break;
+                
+                decode_chunk(rd16(p + 4), p + 6, p + csize);
+                p += csize;
+            }
+            
+            _at += size;
+            _frame++;
+            
+            if (_interval && (_frame - 1) % _interval == 0 && (_frame - 1) / _interval == (int)_snapshots.size())
+            {
+                snapshot snap;
+                snap.frame = _frame - 1;
+                snap.position = _at;
+                snap.pixels = _pixels;
+                memcpy(snap.palette, _palette, sizeof(_palette));
+                _snapshots.push_back(std::move(snap));
+            }
+            
+            return true;
+        }
+        
+        // prefix or unknown chunk
+        _at += size;
+    }
+
+    return false;
+}
+
+void fli_decoder::decode_chunk(uint16_t type, const uint8_t *p, const uint8_t *end)
+{
+    switch (type)
+    {
+        case fli_color256:
+        {
+            decode_color(p, end, 0);
+            break;
+        }
+        case fli_color64:
+        {
+            decode_color(p, end, 2);
+            break;
+        }
+        case fli_byte_run:
+        {
+            decode_byte_run(p, end);
+            break;
+        }
+        case fli_delta_fli:
+        {
+            decode_delta_fli(p, end);
+            break;
+        }
+        case fli_delta_flc:
+        {
+            decode_delta_flc(p, end);
+            break;
+        }
+        case fli_black:
+        {
+            std::fill(_pixels.begin(), _pixels.end(), 0);
+            break;
+        }
+        case fli_copy:
+        {
+            memcpy(_pixels.data(), p, std::min<size_t>(_pixels.size(), end - p));
+            break;
+        }
+        default:
+        {
+            // postage stamp and others
+            break;
+        }
+    }
+}
+
+void fli_decoder::decode_color(const uint8_t *p, const uint8_t *end, int shift)
+{
+    if (end - p < 2)
+        return;
+    
+    int packets = rd16(p);
+    p += 2;
+    
+    int index = 0;
+    for (int i = 0; i < packets && p + 2 <= end; i++)
+    {
+        index += *p++;
+        int count = *p++;
+        if (count == 0)
+            count = 256;
+        
+        count = std::min({ count, 256 - index, (int)(end - p) / 3 });
+        if (count <= 0)
+            break;
+        
+        uint8_t *to = _palette + index * 3;
+        if (shift)
+        {
+            // 6 bit -> 8 bit
+            for (int c = 0; c < count * 3; c++)
+                to[c] = (p[c] << 2) | (p[c] >> 4);
+        }
+        else
+        {
+            memcpy(to, p, count * 3);
+        }
+        
+        p += count * 3;
+        index += count;
+    }
+}
+
+void fli_decoder::decode_byte_run(const uint8_t *p, const uint8_t *end)
+{
+    for (int y = 0; y < _height && p < end; y++)
+    {
+        uint8_t *row = _pixels.data() + y * _width;
+        
+        // packet count is unreliable for wide images, line width decides
+        p++;
+        
+        int x = 0;
+        while (x < _width && p < end)
+        {
+            int8_t count = *p++;
+            if (count >= 0)
+            {
+                if (p >= end)
+                    return;
+                
+                memset(row + x, *p++, clip(count, _width - x, count));
+                x += count;
+            }
+            else
+            {
+                int len = clip(-count, _width - x, end - p);
+                memcpy(row + x, p, len);
+                p += -count;
+                x += -count;
+            }
+        }
+    }
+}
+
+void fli_decoder::decode_delta_fli(const uint8_t *p, const uint8_t *end)
+{
+    if (end - p < 4)
+        return;
+    
+    int y = rd16(p);
+    int lines = rd16(p + 2);
+    p += 4;
+    
+    for (int l = 0; l < lines && y < _height && p < end; l++, y++)
+    {
+        uint8_t *row = _pixels.data() + y * _width;
+        
+        int packets = *p++;
+        int x = 0;
+        
+        for (int i = 0; i < packets && p + 2 <= end; i++)
+        {
+            x += *p++;
+            int8_t count = *p++;
+            
+            if (count >= 0)
+            {
+                int len = clip(count, _width - x, end - p);
+                memcpy(row + x, p, len);
+                p += count;
+                x += count;
+            }
+            else
+            {
+                if (p >= end)
+                    return;
+                
+                int len = clip(-count, _width - x, -count);
+                memset(row + x, *p++, len);
+                x += -count;
+            }
+        }
+    }
+}
+
+void fli_decoder::decode_delta_flc(const uint8_t *p, const uint8_t *end)
+{
+    if (end - p < 2)
+        return;
+    
+    int lines = rd16(p);
+    p += 2;
+    
+    int y = 0;
+    for (int l = 0; l < lines && y < _height && p + 2 <= end; l++, y++)
+    {
+        uint8_t *row = _pixels.data() + y * _width;
+        
+        // optional line skip and last pixel words precede packet count
+        
+        int packets = -1;
+        while (packets < 0 && p + 2 <= end && y < _height)
+        {
+            uint16_t word = rd16(p);
+            p += 2;
+            
+            switch (word & 0xC000)
+            {
+                case 0xC000:
+                {
+                    y += -(int16_t)word;
+                    row = _pixels.data() + y * _width;
+                    break;
+                }
+                case 0x8000:
+                {
+                    if (y < _height)
+                        row[_width - 1] = word & 0xff;
+                    break;
+                }
+                default:
+                {
+                    packets = word;
+                    break;
+                }
+            }
+        }
+        
+        if (y >= _height)
+            break;
+        
+        int x = 0;
+        for (int i = 0; i < packets && p + 2 <= end; i++)
+        {
+            x += *p++;
+            int8_t count = *p++;
+            
+            if (count >= 0)
+            {
+                int len = clip(count * 2, _width - x, end - p);
+                memcpy(row + x, p, len);
+                p += count * 2;
+                x += count * 2;
+            }
+            else
+            {
+                if (p + 2 > end)
+                    return;
+                
+                // fill with word, two pixels at once
+                
+                uint16_t pair;
+                memcpy(&pair, p, 2);
+                p += 2;
+
+                int len = clip(-count * 2, _width - x, -count * 2);
+                uint8_t *to = row + x;
+                for (int w = 0; w + 2 <= len; w += 2)
+                    memcpy(to + w, &pair, 2);
+                
+                if (len & 1)
+                    to[len - 1] = p[-2];
+                
+                x += -count * 2;
+            }
+        }
+    }
+}
+
+int fli_decoder::build_index(int interval)
+{
+    _interval = std::max(1, interval);
+    _positions.clear();
+    _snapshots.clear();
+    
+    rewind();
+    while (decode_next());
+    
+    int frames = _frame;
+    rewind();
+    
+    return frames;
+}
+
+bool fli_decoder::decode_frame(int n)
+{
+    if (n < 0 || n >= _frames)
+        return false;
+    
+    if (n == _frame - 1)
+        return true;
+    
+    // continue from current frame if it is closer than nearest snapshot
+    
+    int nearest = _snapshots.empty() ? -1 : std::min(n / _interval, (int)_snapshots.size() - 1);
+    int from = nearest >= 0 ? _snapshots[nearest].frame : -1;
+    
+    if (n < _frame || _frame - 1 < from)
+    {
+        if (nearest >= 0)
+        {
+            const snapshot& snap = _snapshots[nearest];
+            _pixels = snap.pixels;
+            memcpy(_palette, snap.palette, sizeof(_palette));
+            _at = snap.position;
+            _frame = snap.frame + 1;
+        }
+        else
+        {
+            rewind();
+        }
+    }
+    
+    while (_frame <= n)
+    {
+        if (decode_next() == false)
+            return false;
+    }
+    
+    return true;
+}
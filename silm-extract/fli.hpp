@@ -0,0 +1,96 @@
+//
+//  fli.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef fli_hpp
+#define fli_hpp
+
+#include <stdint.h>
+#include <vector>
+
+enum fli_chunk {
+    
+    fli_color256    = 4,
+    fli_delta_flc   = 7,
+    fli_color64     = 11,
+    fli_delta_fli   = 12,
+    fli_black       = 13,
+    fli_byte_run    = 15,
+    fli_copy        = 16,
+    fli_pstamp      = 18,
+    fli_prefix      = 0xF100,
+    fli_frame       = 0xF1FA
+};
+
+// Decodes FLI (0xAF11) and FLC (0xAF12) animations frame by frame into 8 bit indexed image and 256 color palette.
+class fli_decoder {
+    
+public:
+    
+    fli_decoder(const uint8_t *data, uint32_t size);
+    
+    bool is_valid() const { return _valid; }
+    
+    int width() const { return _width; }
+    int height() const { return _height; }
+    int frames() const { return _frames; }
+    int frame() const { return _frame; }
+
+    // decodes next frame, returns false after last frame or on broken data
+    bool decode_next();
+    void rewind();
+    
+    // scans whole video once, remembers position of every frame and full snapshot of every interval-th frame
+    int build_index(int interval = 16);
+
+    // random access, decodes at most interval frames (everything up to n without index)
+    bool decode_frame(int n);
+    
+    // offset of frame chunk in video data, 0 for frames not scanned yet
+    uint32_t frame_position(int n) const { return n >= 0 && n < (int)_positions.size() ? _positions[n] : 0; }
+    
+    const uint8_t *pixels() const { return _pixels.data(); }
+    const uint8_t *palette() const { return _palette; }
+
+private:
+    
+    struct snapshot {
+        
+        int frame;
+        uint32_t position; // of next frame
+        std::vector<uint8_t> pixels;
+        uint8_t palette[256 * 3];
+    };
+    
+    void decode_chunk(uint16_t type, const uint8_t *p, const uint8_t *end);
+    
+    void decode_color(const uint8_t *p, const uint8_t *end, int shift);
+    void decode_byte_run(const uint8_t *p, const uint8_t *end);
+    void decode_delta_fli(const uint8_t *p, const uint8_t *end);
+    void decode_delta_flc(const uint8_t *p, const uint8_t *end);
+
+    const uint8_t *_data;
+    uint32_t _size;
+    
+    bool _valid;
+    int _width;
+    int _height;
+    int _frames;
+    
+    uint32_t _first;
+    uint32_t _at;
+    int _frame;
+    
+    std::vector<uint8_t> _pixels;
+    uint8_t _palette[256 * 3];
+    
+    // seek index
+    std::vector<uint32_t> _positions;
+    std::vector<snapshot> _snapshots;
+    int _interval;
+};
+
+#endif /* fli_hpp */
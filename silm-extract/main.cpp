@@ -10,6 +10,7 @@ extern "C"
     #include "unpack.h"
 }
 
+#include <algorithm>
 #include <iostream>
 #include <filesystem>
 #include <iostream>
@@ -35,10 +36,44 @@ static void usage() {
     printf("  -t <options>  Specify types of data to extract.\n                ( all | img | pal | cmp | snd )\n");
     printf("  -o <dir>      Output directory.\n");
     printf("  -p <file>     Palette override.\n");
+    printf("  -m <files>    Also save indexed sprites with each of given palettes.\n                ( file,file,... )\n");
     printf("  -f            Force 32 bit depth for all sprites.\n");
+    printf("  -c            Keep sprites indexed, clear color marked transparent.\n");
+    printf("  -v            Convert FLI videos to PNG frames.\n");
+    printf("  -a            Save runs of composites and sprites as animated PNG.\n");
+    printf("  --format <f>  Image file format.\n                ( png | qoi )\n");
+    printf("  --atlas       Pack bitmaps of each script into atlas sheets with rect map.\n");
+    printf("  --tiles <n>   Cut bitmaps into unique n x n tiles, save tileset and tilemaps.\n                ( 8 | 16 )\n");
+    printf("  --phash <d>   Hash bitmaps and composites, group near duplicates within distance d (0-64).\n");
+    printf("  --pack        Also write bitmaps, palettes, samples and videos into one .pak file.\n");
+    printf("  --scan <ext>  Scan raw dumps for address blocks, decode as scripts of given extension.\n                ( ao | co | do | fo | io | mo )\n");
+    printf("  --shard <i/n> Extract only the i-th of n disjoint shares of a directory (i from 0).\n                ( not with --tiles, --pack )\n");
+    printf("  --merge       Merge catalogs of shards found in <dir> into one.\n");
+    printf("  --mem-limit <mb>\n                Keep decoded assets within given memory budget in MB.\n");
+    printf("  --watch       Keep running, re-extract scripts as they change.\n");
+    printf("  -r <rate>     Transcode samples to 16 bit PCM at given rate (e.g. 44100).\n");
     printf("\n");
 }
 
+static char *load_palette(const path& file)
+{
+    std::ifstream is(file, std::ifstream::binary);
+    if (!is)
+        return NULL;
+    
+    is.seekg (0, is.end);
+    long length = is.tellg();
+    is.seekg (0, is.beg);
+    
+    if (length != 768)
+        return NULL;
+    
+    char *paldata = new char [length];
+    is.read(paldata, length);
+    is.close();
+    return paldata;
+}
+
 void tokenize(std::string const& str, const char delim, std::vector<std::string>& out)
 {
     size_t start;
@@ -92,6 +127,22 @@ int main(int argc, const char * argv[])
             path palette = "";
             bool force_tc = false;
             bool list_only = false;
+            bool convert_video = false;
+            bool animate = false;
+            bool transparent = false;
+            image_format format = format_png;
+            bool atlas = false;
+            int tiles = 0;
+            int phash = -1;
+            bool pack = false;
+            std::string scan;
+            bool watch = false;
+            int shard_index = 0;
+            int shard_count = 0;
+            bool merge = false;
+            int mem_limit = 0;
+            std::vector<PaletteVariant> variants;
+            int sample_rate = 0;
             uint32_t ex_type = ex_everything;
 
             for (int c = 1; c < argc; c++)
@@ -188,17 +239,179 @@ int main(int argc, const char * argv[])
                     c++;
                 }
                 
+                if (cmd == "-m" && c + 1 < argc)
+                {
+                    std::vector<std::string> out;
+                    tokenize(argv[c + 1], ',', out);
+                    
+                    for (auto &s: out)
+                    {
+                        path file = s;
+                        if (std::filesystem::is_regular_file(file) == false)
+                        {
+                            file = current_dir;
+                            file.append(s);
+                        }
+                        
+                        char *paldata = load_palette(file);
+                        if (paldata == NULL)
+                        {
+                            std::cout << "Wrong palette: " << s << std::endl;
+                            return errno;
+                        }
+                        
+                        variants.push_back({ file.stem().string(), (uint8_t *)paldata });
+                    }
+                    
+                    c++;
+                }
+                
                 if (cmd == "-f")
                 {
                     force_tc = true;
                 }
                 
+                if (cmd == "-c")
+                {
+                    transparent = true;
+                }
+                
                 if (cmd == "-l")
                 {
                     list_only = true;
                 }
+                
+                if (cmd == "-v")
+                {
+                    convert_video = true;
+                }
+                
+                if (cmd == "--format" && c + 1 < argc)
+                {
+                    std::string f = argv[c + 1];
+                    if (f == "png")
+                    {
+                        format = format_png;
+                    }
+                    else if (f == "qoi")
+                    {
+                        format = format_qoi;
+                    }
+                    else
+                    {
+                        std::cout << "Wrong image format!" << std::endl;
+                        return errno;
+                    }
+                    
+                    c++;
+                }
+                
+                if (cmd == "--atlas")
+                {
+                    atlas = true;
+                }
+                
+                if (cmd == "--tiles" && c + 1 < argc)
+                {
+                    tiles = atoi(argv[c + 1]);
+                    if (tiles != 8 && tiles != 16)
+                    {
+                        std::cout << "Wrong tile size!" << std::endl;
+                        return errno;
+                    }
+                    
+                    c++;
+                }
+                
+                if (cmd == "--phash" && c + 1 < argc)
+                {
+                    phash = atoi(argv[c + 1]);
+                    if (phash < 0 || phash > 64)
+                    {
+                        std::cout << "Wrong hash distance!" << std::endl;
+                        return errno;
+                    }
+                    
+                    c++;
+                }
+                
+                if (cmd == "--pack")
+                {
+                    pack = true;
+                }
+                
+                if (cmd == "--scan" && c + 1 < argc)
+                {
+                    scan = argv[c + 1];
+                    std::transform(scan.begin(), scan.end(), scan.begin(), ::tolower);
+                    if (extractor::is_script("dump." + scan) == false)
+                    {
+                        std::cout << "Wrong script extension!" << std::endl;
+                        return errno;
+                    }
+                    
+                    c++;
+                }
+                
+                if (cmd == "--shard" && c + 1 < argc)
+                {
+                    if (sscanf(argv[c + 1], "%d/%d", &shard_index, &shard_count) != 2 || shard_count < 1 || shard_index < 0 || shard_index >= shard_count)
+                    {
+                        std::cout << "Wrong shard!" << std::endl;
+                        return errno;
+                    }
+                    
+                    c++;
+                }
+                
+                if (cmd == "--merge")
+                {
+                    merge = true;
+                }
+                
+                if (cmd == "--mem-limit" && c + 1 < argc)
+                {
+                    mem_limit = atoi(argv[c + 1]);
+                    if (mem_limit < 1)
+                    {
+                        std::cout << "Wrong memory limit!" << std::endl;
+                        return errno;
+                    }
+                    
+                    c++;
+                }
+                
+                if (cmd == "--watch")
+                {
+                    watch = true;
+                }
+                
+                if (cmd == "-a")
+                {
+                    animate = true;
+                }
+                
+                if (cmd == "-r" && c + 1 < argc)
+                {
+                    sample_rate = atoi(argv[c + 1]);
+                    if (sample_rate < 4000 || sample_rate > 192000)
+                    {
+                        std::cout << "Wrong sample rate!" << std::endl;
+                        return errno;
+                    }
+                    
+                    c++;
+                }
             }
 
+            // NOTE: tilesets and packs are built across all scripts of a run, shards of them could not be merged
+            
+            if (shard_count && (tiles || pack))
+            {
+                std::cout << "Shards can't be combined with --tiles or --pack!" << std::endl;
+                return errno;
+            }
+            
             char *paldata = NULL;
             if (std::filesystem::is_regular_file(palette))
             {
@@ -222,7 +435,26 @@ int main(int argc, const char * argv[])
             }
             
             extractor ex = extractor(output, paldata, force_tc, list_only);
-            if (std::filesystem::is_directory(input))
+            ex.set_sample_rate(sample_rate);
+            ex.set_convert_video(convert_video);
+            ex.set_animate(animate);
+            ex.set_transparent(transparent);
+            ex.set_palette_variants(variants);
+            ex.set_image_format(format);
+            ex.set_atlas(atlas);
+            ex.set_tiles(tiles);
+            ex.set_phash(phash);
+            ex.set_pack(pack);
+            ex.set_scan(scan);
+            
+            ex.set_shard(shard_index, shard_count);
+            ex.set_mem_limit((uint64_t)mem_limit << 20);
+            
+            if (merge)
+            {
+                ex.merge_shards(std::filesystem::is_directory(input) ? input : input.parent_path());
+            }
+            else if (std::filesystem::is_directory(input))
             {
                 ex.extract_dir(input, ex_type);
             }
@@ -230,6 +462,11 @@ int main(int argc, const char * argv[])
             {
                 ex.extract_file(input, ex_type);
             }
+            
+            if (watch && merge == false)
+            {
+                ex.watch(input, ex_type);
+            }
         }
         
 //        depack((char *)argv[1]);
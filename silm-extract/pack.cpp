@@ -0,0 +1,125 @@
+//
+//  pack.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "pack.hpp"
+
+#include <string.h>
+
+pack_writer::pack_writer()
+{
+    _fp = NULL;
+    _size = 0;
+    _platform = 0;
+}
+
+pack_writer::~pack_writer()
+{
+    if (_fp)
+    {
+        fclose(_fp);
+        std::filesystem::remove(_temp);
+    }
+}
+
+void pack_writer::begin_script(const std::filesystem::path& dir, const std::string& name, uint8_t platform)
+{
+    if (_fp == NULL)
+    {
+        _temp = dir / "pack.tmp";
+        _fp = fopen(_temp.string().c_str(), "wb");
+        if (!_fp)
+            abort();
+        
+        // header is written by save
+        
+        PackHeader header = {};
+        append((const uint8_t *)&header, sizeof(header));
+    }
+    
+    _scripts.push_back(name);
+    _platform = platform;
+}
+
+uint64_t pack_writer::append(const uint8_t *data, size_t length)
+{
+    static const uint8_t zero[PACK_ALIGN] = {};
+    
+    uint64_t pad = (PACK_ALIGN - _size % PACK_ALIGN) % PACK_ALIGN;
+    if (pad && fwrite(zero, pad, 1, _fp) != 1)
+        abort();
+    
+    uint64_t offset = _size + pad;
+    if (length && fwrite(data, length, 1, _fp) != 1)
+        abort();
+    
+    _size = offset + length;
+    return offset;
+}
+
+uint16_t pack_writer::add_palette(const uint8_t *rgb, uint8_t type)
+{
+    std::string key((const char *)rgb, 256 * 3);
+    auto it = _palettes.find(key);
+    if (it != _palettes.end())
+        return it->second;
+    
+    uint16_t record = (uint16_t)_records.size();
+    add(PACK_NONE, type, rgb, 256 * 3);
+    _palettes[key] = record;
+    return record;
+}
+
+void pack_writer::add(uint16_t entry, uint8_t type, const uint8_t *data, size_t length, uint16_t palette, int width, int height, int clear, int rate)
+{
+    PackRecord r = {};
+    r.script = (uint16_t)(_scripts.size() - 1);
+    r.entry = entry;
+    r.type = type;
+    r.platform = _platform;
+    r.palette = palette;
+    r.width = (uint16_t)width;
+    r.height = (uint16_t)height;
+    r.clear = (int16_t)clear;
+    r.rate = (uint16_t)rate;
+    r.offset = append(data, length);
+    r.length = length;
+    _records.push_back(r);
+}
+
+void pack_writer::save(const std::filesystem::path& path)
+{
+    if (_fp == NULL)
+        return;
+    
+    PackHeader header = {};
+    memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.scripts = (uint32_t)_scripts.size();
+    header.records = (uint32_t)_records.size();
+    
+    std::vector<char> names(_scripts.size() * PACK_NAME, 0);
+    for (size_t i = 0; i < _scripts.size(); i++)
+        strncpy(names.data() + i * PACK_NAME, _scripts[i].c_str(), PACK_NAME - 1);
+    
+    header.names = append((const uint8_t *)names.data(), names.size());
+    header.index = append((const uint8_t *)_records.data(), _records.size() * sizeof(PackRecord));
+    
+    if (fseek(_fp, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, _fp) != 1)
+        abort();
+    
+    fclose(_fp);
+    _fp = NULL;
+    
+    if (_records.empty())
+        std::filesystem::remove(_temp);
+    else
+        std::filesystem::rename(_temp, path);
+    
+    _scripts.clear();
+    _records.clear();
+    _palettes.clear();
+}
@@ -0,0 +1,100 @@
+//
+//  pack.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef pack_hpp
+#define pack_hpp
+
+#include <filesystem>
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Asset pack, one file per game, meant to be memory mapped and used as is.
+// Layout (little endian): PackHeader, data blobs, script names, records. Every
+// blob, the name table and the record table start at a PACK_ALIGN boundary.
+//
+//  bitmaps     width * height bytes, one palette index per pixel
+//  palettes    256 rgb triplets
+//  samples     8 bit unsigned PCM
+//  videos      FLI file as found in script
+
+#define PACK_MAGIC          "SPAK"
+#define PACK_VERSION        1
+#define PACK_ALIGN          64
+#define PACK_NAME           32
+#define PACK_NONE           0xffff
+
+struct PackHeader {
+    
+    char magic[4];
+    uint32_t version;
+    uint32_t scripts;       // char[PACK_NAME] per script at names
+    uint32_t records;       // PackRecord per asset at index
+    uint64_t names;
+    uint64_t index;
+};
+
+struct PackRecord {
+    
+    uint16_t script;
+    uint16_t entry;         // entry index in script, PACK_NONE for palettes
+    uint8_t type;           // data_type
+    uint8_t platform;       // alis_platform
+    uint16_t palette;       // record of bitmap palette, PACK_NONE for none
+    uint16_t width;
+    uint16_t height;
+    int16_t clear;          // transparent color, -1 for none
+    uint16_t rate;          // sample rate in Hz
+    uint64_t offset;
+    uint64_t length;
+};
+
+static_assert(sizeof(PackHeader) == 32, "pack header layout");
+static_assert(sizeof(PackRecord) == 32, "pack record layout");
+
+// Blobs are streamed to a temporary file as they come, names and records
+// are appended at the end and the header written last.
+
+class pack_writer {
+    
+public:
+    
+    pack_writer();
+    ~pack_writer();
+    
+    pack_writer(const pack_writer&) = delete;
+    pack_writer& operator=(const pack_writer&) = delete;
+    
+    void begin_script(const std::filesystem::path& dir, const std::string& name, uint8_t platform);
+    
+    // palettes are stored once per distinct content, returns their record
+    uint16_t add_palette(const uint8_t *rgb, uint8_t type);
+    void add(uint16_t entry, uint8_t type, const uint8_t *data, size_t length, uint16_t palette = PACK_NONE,
+             int width = 0, int height = 0, int clear = -1, int rate = 0);
+    
+    // moves temporary file to path, nothing is written without records
+    void save(const std::filesystem::path& path);
+    
+    size_t records() const { return _records.size(); }
+    
+private:
+    
+    uint64_t append(const uint8_t *data, size_t length);
+    
+    FILE *_fp;
+    std::filesystem::path _temp;
+    uint64_t _size;
+    uint8_t _platform;
+    
+    std::vector<std::string> _scripts;
+    std::vector<PackRecord> _records;
+    std::map<std::string, uint16_t> _palettes;  // contents -> record
+};
+
+#endif /* pack_hpp */
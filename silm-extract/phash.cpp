@@ -0,0 +1,116 @@
+//
+//  phash.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "phash.hpp"
+
+#include <algorithm>
+
+uint64_t phash::dhash(const uint32_t *rgba, int width, int height)
+{
+    // NOTE: every cell covers at least one pixel, so sprites smaller than 9 x 8 work too
+    
+    int cells[8][9];
+    for (int cy = 0; cy < 8; cy++)
+    {
+        int y0 = cy * height / 8;
+        int y1 = std::max(y0 + 1, (cy + 1) * height / 8);
+        
+        for (int cx = 0; cx < 9; cx++)
+        {
+            int x0 = cx * width / 9;
+            int x1 = std::max(x0 + 1, (cx + 1) * width / 9);
+            
+            uint32_t sum = 0;
+            for (int y = y0; y < y1; y++)
+            {
+                const uint8_t *p = (const uint8_t *)(rgba + y * width);
+                for (int x = x0; x < x1; x++)
+                {
+                    const uint8_t *c = p + x * 4;
+                    sum += c[3] ? 77 * c[0] + 150 * c[1] + 29 * c[2] : 0;
+                }
+            }
+            
+            cells[cy][cx] = sum / ((y1 - y0) * (x1 - x0));
+        }
+    }
+    
+    int lo = cells[0][0];
+    int hi = cells[0][0];
+    for (int cy = 0; cy < 8; cy++)
+    {
+        for (int cx = 0; cx < 9; cx++)
+        {
+            lo = std::min(lo, cells[cy][cx]);
+            hi = std::max(hi, cells[cy][cx]);
+        }
+    }
+    
+    // stretch to 0..255, steps under half of one 4 bit color level are ignored
+    
+    uint64_t hash = 0;
+    for (int cy = 0; cy < 8; cy++)
+    {
+        for (int cx = 0; cx < 8; cx++)
+        {
+            int a = hi > lo ? (cells[cy][cx] - lo) * 255 / (hi - lo) : 0;
+            int b = hi > lo ? (cells[cy][cx + 1] - lo) * 255 / (hi - lo) : 0;
+            hash = hash << 1 | (a > b + 8);
+        }
+    }
+    
+    return hash;
+}
+
+void hash_index::add(uint64_t hash, uint32_t id)
+{
+    uint32_t at = (uint32_t)_hashes.size();
+    _hashes.push_back(hash);
+    _ids.push_back(id);
+    
+    for (int p = 0; p < 4; p++)
+    {
+        _parts[p][(uint16_t)(hash >> (p * 16))].push_back(at);
+    }
+}
+
+void hash_index::probe(int part, uint16_t key, int flips, int from, std::vector<uint32_t>& candidates) const
+{
+    auto it = _parts[part].find(key);
+    if (it != _parts[part].end())
+        candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+    
+    if (flips == 0)
+        return;
+    
+    for (int b = from; b < 16; b++)
+    {
+        probe(part, key ^ (1 << b), flips - 1, b + 1, candidates);
+    }
+}
+
+void hash_index::find(uint64_t hash, int distance, std::vector<uint32_t>& ids) const
+{
+    ids.clear();
+    
+    std::vector<uint32_t> candidates;
+    for (int p = 0; p < 4; p++)
+    {
+        probe(p, (uint16_t)(hash >> (p * 16)), distance / 4, 0, candidates);
+    }
+    
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    
+    for (uint32_t at : candidates)
+    {
+        if (phash::distance(_hashes[at], hash) <= distance)
+            ids.push_back(_ids[at]);
+    }
+    
+    std::sort(ids.begin(), ids.end());
+}
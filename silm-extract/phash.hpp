@@ -0,0 +1,46 @@
+//
+//  phash.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef phash_hpp
+#define phash_hpp
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace phash {
+
+    // 64 bit difference hash: luminance box filtered to 9 x 8, contrast stretched,
+    // one bit per horizontal neighbour pair. Transparent pixels count as black.
+    uint64_t dhash(const uint32_t *rgba, int width, int height);
+
+    inline int distance(uint64_t a, uint64_t b) { return __builtin_popcountll(a ^ b); }
+}
+
+// Multi-index hashing. Hashes are split into 4 parts of 16 bits, two hashes within
+// distance d have at least one part within d / 4, so only buckets close to the
+// parts of the query are probed instead of comparing with every hash.
+
+class hash_index {
+    
+public:
+    
+    void add(uint64_t hash, uint32_t id);
+    
+    // ids of all hashes within distance, ascending
+    void find(uint64_t hash, int distance, std::vector<uint32_t>& ids) const;
+    
+private:
+    
+    void probe(int part, uint16_t key, int flips, int from, std::vector<uint32_t>& candidates) const;
+    
+    std::vector<uint64_t> _hashes;
+    std::vector<uint32_t> _ids;
+    std::unordered_map<uint16_t, std::vector<uint32_t>> _parts[4];   // part value -> positions
+};
+
+#endif /* phash_hpp */
@@ -0,0 +1,246 @@
+//
+//  png_encoder.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "png_encoder.hpp"
+#include "blit.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+
+// same values as libpng
+enum {
+    
+    color_gray          = 0,
+    color_rgb           = 2,
+    color_palette       = 3,
+    color_gray_alpha    = 4,
+    color_rgba          = 6
+};
+
+static void put4b(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+static inline uint8_t paeth(int a, int b, int c)
+{
+    int pa = abs(b - c);
+    int pb = abs(a - c);
+    int pc = abs(a + b - 2 * c);
+    int ab = pb < pa ? b : a;
+    return pc < std::min(pa, pb) ? c : ab;
+}
+
+// sum of filtered bytes taken as signed values
+static inline uint32_t cost(const uint8_t *p, int bytes)
+{
+    int x = 0;
+    uint32_t sum = 0;
+    
+#if defined(SIMD_SSSE3)
+    __m128i acc = _mm_setzero_si128();
+    for (; x + 16 <= bytes; x += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_abs_epi8(_mm_loadu_si128((const __m128i *)(p + x))), _mm_setzero_si128()));
+    
+    sum = (uint32_t)(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8)));
+#elif defined(SIMD_NEON)
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; x + 16 <= bytes; x += 16)
+        acc = vpadalq_u16(acc, vpaddlq_u8(vreinterpretq_u8_s8(vabsq_s8(vreinterpretq_s8_u8(vld1q_u8(p + x))))));
+    
+    sum = vaddvq_u32(acc);
+#endif
+    
+    for (; x < bytes; x++)
+        sum += p[x] < 128 ? p[x] : 256 - p[x];
+    
+    return sum;
+}
+
+// filters row into dst (filter type byte first), picks the filter with smallest sum of
+// absolute values like libpng does for truecolor images. scratch holds 4 rows.
+static void filter_row(const uint8_t *row, const uint8_t *prior, int bytes, int bpp, uint8_t *dst, uint8_t *scratch)
+{
+    uint8_t *sub = scratch;
+    uint8_t *up = scratch + bytes;
+    uint8_t *avg = scratch + bytes * 2;
+    uint8_t *pth = scratch + bytes * 3;
+    
+    for (int x = 0; x < bpp; x++)
+    {
+        int b = prior ? prior[x] : 0;
+        sub[x] = row[x];
+        up[x] = row[x] - b;
+        avg[x] = row[x] - (b >> 1);
+        pth[x] = row[x] - b;
+    }
+    
+    for (int x = bpp; x < bytes; x++)
+        sub[x] = row[x] - row[x - bpp];
+    
+    if (prior)
+    {
+        for (int x = bpp; x < bytes; x++)
+            up[x] = row[x] - prior[x];
+        
+        for (int x = bpp; x < bytes; x++)
+            avg[x] = row[x] - ((row[x - bpp] + prior[x]) >> 1);
+        
+        for (int x = bpp; x < bytes; x++)
+            pth[x] = row[x] - paeth(row[x - bpp], prior[x], prior[x - bpp]);
+    }
+    else
+    {
+        // without prior row up is none, average halves left pixel and paeth is sub
+        
+        memcpy(up + bpp, row + bpp, bytes - bpp);
+        for (int x = bpp; x < bytes; x++)
+            avg[x] = row[x] - (row[x - bpp] >> 1);
+        
+        memcpy(pth + bpp, sub + bpp, bytes - bpp);
+    }
+    
+    const uint8_t *candidates[5] = { row, sub, up, avg, pth };
+    
+    int best = 0;
+    uint32_t best_sum = UINT32_MAX;
+    for (int f = 0; f < 5; f++)
+    {
+        uint32_t sum = cost(candidates[f], bytes);
+        if (sum < best_sum)
+        {
+            best_sum = sum;
+            best = f;
+        }
+    }
+    
+    dst[0] = best;
+    memcpy(dst + 1, candidates[best], bytes);
+}
+
+png_encoder::png_encoder()
+{
+    memset(&_zs, 0, sizeof(_zs));
+    if (deflateInit2(&_zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        abort();
+}
+
+png_encoder::~png_encoder()
+{
+    deflateEnd(&_zs);
+}
+
+png_encoder& png_encoder::local()
+{
+    thread_local png_encoder encoder;
+    return encoder;
+}
+
+void png_encoder::chunk(std::vector<uint8_t>& out, const char *type, const uint8_t *data, uint32_t length)
+{
+    size_t at = out.size();
+    out.resize(at + 12 + length);
+    
+    uint8_t *p = out.data() + at;
+    put4b(p, length);
+    memcpy(p + 4, type, 4);
+    if (length)
+        memcpy(p + 8, data, length);
+    
+    put4b(p + 8 + length, (uint32_t)crc32(0, p + 4, 4 + length));
+}
+
+void png_encoder::compress(const uint8_t *data, size_t size, std::vector<uint8_t>& out, int strategy)
+{
+    if (deflateReset(&_zs) != Z_OK || deflateParams(&_zs, Z_DEFAULT_COMPRESSION, strategy) != Z_OK)
+        abort();
+    
+    out.resize(deflateBound(&_zs, (uLong)size));
+    
+    _zs.next_in = (Bytef *)data;
+    _zs.avail_in = (uInt)size;
+    _zs.next_out = out.data();
+    _zs.avail_out = (uInt)out.size();
+    
+    if (deflate(&_zs, Z_FINISH) != Z_STREAM_END)
+        abort();
+    
+    out.resize(_zs.total_out);
+}
+
+void png_encoder::encode(std::vector<uint8_t>& out, int width, int height, int color_type, int bit_depth, const uint8_t *data,
+                         const uint8_t *palette, int colors, const uint8_t *alpha, int alphas, const uint8_t *lut)
+{
+    int channels = color_type == color_rgba ? 4 : color_type == color_rgb ? 3 : color_type == color_gray_alpha ? 2 : 1;
+    int stride = width * channels;
+    int bytes = (width * channels * bit_depth + 7) / 8;
+    
+    // NOTE: like libpng, only truecolor rows are filtered
+    
+    bool filtered = bit_depth == 8 && color_type != color_palette;
+    
+    uint8_t identity[256];
+    if (lut == NULL)
+    {
+        for (int c = 0; c < 256; c++)
+            identity[c] = c;
+        lut = identity;
+    }
+    
+    _raw.resize((size_t)(bytes + 1) * height);
+    _row.resize(bytes * 4);
+    
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t *src = data + (size_t)y * stride;
+        uint8_t *dst = _raw.data() + (size_t)y * (bytes + 1);
+        
+        if (filtered)
+        {
+            filter_row(src, y ? src - stride : NULL, bytes, channels, dst, _row.data());
+        }
+        else if (bit_depth < 8)
+        {
+            dst[0] = 0;
+            blit::pack(src, dst + 1, width, bit_depth, lut);
+        }
+        else
+        {
+            dst[0] = 0;
+            memcpy(dst + 1, src, bytes);
+        }
+    }
+    
+    compress(_raw.data(), _raw.size(), _idat, filtered ? Z_FILTERED : Z_DEFAULT_STRATEGY);
+    
+    out.clear();
+    out.reserve(8 + 25 + 12 + colors * 3 + 12 + alphas + 12 + _idat.size() + 12);
+    
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out.insert(out.end(), signature, signature + 8);
+    
+    uint8_t header[13] = { 0, 0, 0, 0, 0, 0, 0, 0, (uint8_t)bit_depth, (uint8_t)color_type, 0, 0, 0 };
+    put4b(header, width);
+    put4b(header + 4, height);
+    chunk(out, "IHDR", header, sizeof(header));
+    
+    if (color_type == color_palette)
+    {
+        chunk(out, "PLTE", palette, colors * 3);
+        
+        if (alpha && alphas)
+            chunk(out, "tRNS", alpha, alphas);
+    }
+    
+    chunk(out, "IDAT", _idat.data(), (uint32_t)_idat.size());
+    chunk(out, "IEND", NULL, 0);
+}
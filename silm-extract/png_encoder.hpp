@@ -0,0 +1,50 @@
+//
+//  png_encoder.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef png_encoder_hpp
+#define png_encoder_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <zlib.h>
+
+// PNG writer keeping its deflate state and scratch buffers between images.
+// Each thread gets its own instance (see local), released when the thread ends.
+
+class png_encoder {
+    
+public:
+    
+    png_encoder();
+    ~png_encoder();
+    
+    png_encoder(const png_encoder&) = delete;
+    png_encoder& operator=(const png_encoder&) = delete;
+    
+    static png_encoder& local();
+    
+    // data is 8 bits per channel, indexed pixels are packed to bit_depth through lut (NULL keeps values),
+    // palette holds colors rgb triplets, alpha (tRNS) alphas entries
+    void encode(std::vector<uint8_t>& out, int width, int height, int color_type, int bit_depth, const uint8_t *data,
+                const uint8_t *palette = NULL, int colors = 0, const uint8_t *alpha = NULL, int alphas = 0, const uint8_t *lut = NULL);
+    
+    // zlib stream of data (for APNG frames)
+    void compress(const uint8_t *data, size_t size, std::vector<uint8_t>& out, int strategy = Z_DEFAULT_STRATEGY);
+    
+    static void chunk(std::vector<uint8_t>& out, const char *type, const uint8_t *data, uint32_t length);
+    
+private:
+    
+    z_stream _zs;
+    
+    std::vector<uint8_t> _raw;      // filtered rows
+    std::vector<uint8_t> _idat;
+    std::vector<uint8_t> _row;      // filter candidates
+};
+
+#endif /* png_encoder_hpp */
@@ -0,0 +1,153 @@
+//
+//  qoi.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "qoi.hpp"
+
+#include <string.h>
+
+enum {
+    
+    qoi_op_index    = 0x00,
+    qoi_op_diff     = 0x40,
+    qoi_op_luma     = 0x80,
+    qoi_op_run      = 0xc0,
+    qoi_op_rgb      = 0xfe,
+    qoi_op_rgba     = 0xff
+};
+
+union pixel {
+    
+    struct { uint8_t r, g, b, a; } c;
+    uint32_t v;
+};
+
+static void put4b(uint8_t *p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// source returns pixel n
+template <typename source>
+static void encode_pixels(std::vector<uint8_t>& out, int width, int height, source pixel_at)
+{
+    size_t count = (size_t)width * height;
+    
+    // worst case is one rgba op per pixel
+    out.resize(14 + count * 5 + 8);
+    uint8_t *p = out.data();
+    
+    memcpy(p, "qoif", 4);
+    put4b(p + 4, width);
+    put4b(p + 8, height);
+    p[12] = 4;  // channels
+    p[13] = 0;  // sRGB with linear alpha
+    p += 14;
+    
+    pixel index[64];
+    memset(index, 0, sizeof(index));
+    
+    pixel prev;
+    prev.c = { 0, 0, 0, 255 };
+    
+    int run = 0;
+    for (size_t n = 0; n < count; n++)
+    {
+        pixel px = pixel_at(n);
+        
+        if (px.v == prev.v)
+        {
+            run++;
+            if (run == 62 || n + 1 == count)
+            {
+                *p++ = qoi_op_run | (run - 1);
+                run = 0;
+            }
+            
+            continue;
+        }
+        
+        if (run > 0)
+        {
+            *p++ = qoi_op_run | (run - 1);
+            run = 0;
+        }
+        
+        int slot = (px.c.r * 3 + px.c.g * 5 + px.c.b * 7 + px.c.a * 11) % 64;
+        if (index[slot].v == px.v)
+        {
+            *p++ = qoi_op_index | slot;
+        }
+        else
+        {
+            index[slot] = px;
+            
+            if (px.c.a == prev.c.a)
+            {
+                int8_t vr = px.c.r - prev.c.r;
+                int8_t vg = px.c.g - prev.c.g;
+                int8_t vb = px.c.b - prev.c.b;
+                int8_t vg_r = vr - vg;
+                int8_t vg_b = vb - vg;
+                
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                {
+                    *p++ = qoi_op_diff | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                }
+                else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 && vg_b > -9 && vg_b < 8)
+                {
+                    *p++ = qoi_op_luma | (vg + 32);
+                    *p++ = (vg_r + 8) << 4 | (vg_b + 8);
+                }
+                else
+                {
+                    *p++ = qoi_op_rgb;
+                    *p++ = px.c.r;
+                    *p++ = px.c.g;
+                    *p++ = px.c.b;
+                }
+            }
+            else
+            {
+                *p++ = qoi_op_rgba;
+                *p++ = px.c.r;
+                *p++ = px.c.g;
+                *p++ = px.c.b;
+                *p++ = px.c.a;
+            }
+        }
+        
+        prev = px;
+    }
+    
+    static const uint8_t padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    memcpy(p, padding, sizeof(padding));
+    p += sizeof(padding);
+    
+    out.resize(p - out.data());
+}
+
+void qoi::encode(std::vector<uint8_t>& out, int width, int height, const uint8_t *rgba)
+{
+    encode_pixels(out, width, height, [rgba](size_t n) {
+        
+        pixel px;
+        memcpy(&px, rgba + n * 4, 4);
+        return px;
+    });
+}
+
+void qoi::encode(std::vector<uint8_t>& out, int width, int height, const uint8_t *indexed, const uint8_t *palette, int clear)
+{
+    pixel colors[256];
+    for (int c = 0; c < 256; c++)
+        colors[c].c = { palette[c * 3 + 0], palette[c * 3 + 1], palette[c * 3 + 2], (uint8_t)(c == clear ? 0 : 255) };
+    
+    encode_pixels(out, width, height, [indexed, &colors](size_t n) { return colors[indexed[n]]; });
+}
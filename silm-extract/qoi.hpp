@@ -0,0 +1,24 @@
+//
+//  qoi.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef qoi_hpp
+#define qoi_hpp
+
+#include <stdint.h>
+#include <vector>
+
+// "Quite OK Image" format (qoiformat.org), always 4 channels
+
+namespace qoi {
+
+    void encode(std::vector<uint8_t>& out, int width, int height, const uint8_t *rgba);
+
+    // indexed pixels expanded while encoding, clear color gets alpha 0 (-1 for none)
+    void encode(std::vector<uint8_t>& out, int width, int height, const uint8_t *indexed, const uint8_t *palette, int clear = -1);
+}
+
+#endif /* qoi_hpp */
@@ -0,0 +1,72 @@
+//
+//  scan.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "scan.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+
+void scan::table_candidates(const uint8_t *data, size_t length, size_t from, size_t to, bool little_endian, std::vector<uint32_t>& out)
+{
+    // NOTE: 16 start offsets per step, high bytes of the 4 words are at +0, +4, +8, +12
+    // (+3 more for little endian), so 31 bytes past the first offset have to be there
+    
+    const uint8_t *high = data + (little_endian ? 3 : 0);
+    if (length < 31)
+        return;
+    
+    to = std::min(to, length - 31);
+    from += from & 1;
+    
+    size_t s = from;
+    
+#if defined(SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; s + 16 <= to; s += 16)
+    {
+        __m128i z = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(high + s)), zero);
+        z = _mm_and_si128(z, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(high + s + 4)), zero));
+        z = _mm_and_si128(z, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(high + s + 8)), zero));
+        z = _mm_and_si128(z, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(high + s + 12)), zero));
+        
+        uint32_t mask = _mm_movemask_epi8(z) & 0x5555;
+        while (mask)
+        {
+            out.push_back((uint32_t)(s + __builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+#elif defined(SIMD_NEON)
+    const uint8x16_t bits = { 1, 0, 4, 0, 16, 0, 64, 0, 1, 0, 4, 0, 16, 0, 64, 0 };
+    for (; s + 16 <= to; s += 16)
+    {
+        uint8x16_t z = vceqzq_u8(vld1q_u8(high + s));
+        z = vandq_u8(z, vceqzq_u8(vld1q_u8(high + s + 4)));
+        z = vandq_u8(z, vceqzq_u8(vld1q_u8(high + s + 8)));
+        z = vandq_u8(z, vceqzq_u8(vld1q_u8(high + s + 12)));
+        
+        if (vmaxvq_u8(z) == 0)
+            continue;
+        
+        // even lanes only, one bit each
+        
+        uint8x16_t m = vandq_u8(z, bits);
+        uint32_t mask = vaddv_u8(vget_low_u8(m)) | vaddv_u8(vget_high_u8(m)) << 8;
+        while (mask)
+        {
+            out.push_back((uint32_t)(s + __builtin_ctz(mask)));
+            mask &= mask - 1;
+        }
+    }
+#endif
+    
+    for (; s < to; s += 2)
+    {
+        if (high[s] == 0 && high[s + 4] == 0 && high[s + 8] == 0 && high[s + 12] == 0)
+            out.push_back((uint32_t)s);
+    }
+}
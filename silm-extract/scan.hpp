@@ -0,0 +1,22 @@
+//
+//  scan.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef scan_hpp
+#define scan_hpp
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace scan {
+
+    // even offsets in [from, to) starting 4 consecutive 32 bit words with zero high byte,
+    // what every address table of a blob below 16 MB looks like (SIMD prefilter)
+    void table_candidates(const uint8_t *data, size_t length, size_t from, size_t to, bool little_endian, std::vector<uint32_t>& out);
+}
+
+#endif /* scan_hpp */
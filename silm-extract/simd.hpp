@@ -0,0 +1,26 @@
+//
+//  simd.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef simd_hpp
+#define simd_hpp
+
+// NOTE: x86_64 always has SSE2, SSSE3 is there on every Mac since core2,
+// Apple silicon always has NEON. Everything else falls back to scalar code.
+
+#if defined(__SSSE3__)
+    #include <tmmintrin.h>
+    #define SIMD_SSE2   1
+    #define SIMD_SSSE3  1
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+    #define SIMD_SSE2   1
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define SIMD_NEON   1
+#endif
+
+#endif /* simd_hpp */
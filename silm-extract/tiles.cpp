@@ -0,0 +1,135 @@
+//
+//  tiles.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "tiles.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+// NOTE: four 32 bit lanes of add / xorshift mixing, one 16 byte load per round.
+// Scalar code does exactly the same per lane, so hashes match on every platform.
+
+static uint64_t hash_tile(const uint32_t *data, int count)
+{
+    uint32_t lanes[4] = { 0x9e3779b9, 0x85ebca6b, 0xc2b2ae35, 0x27d4eb2f };
+    int i = 0;
+    
+#if defined(SIMD_SSE2)
+    __m128i h = _mm_loadu_si128((const __m128i *)lanes);
+    for (; i + 4 <= count; i += 4)
+    {
+        h = _mm_add_epi32(h, _mm_loadu_si128((const __m128i *)(data + i)));
+        h = _mm_xor_si128(h, _mm_slli_epi32(h, 13));
+        h = _mm_xor_si128(h, _mm_srli_epi32(h, 17));
+        h = _mm_add_epi32(h, _mm_slli_epi32(h, 5));
+    }
+    
+    _mm_storeu_si128((__m128i *)lanes, h);
+#elif defined(SIMD_NEON)
+    uint32x4_t h = vld1q_u32(lanes);
+    for (; i + 4 <= count; i += 4)
+    {
+        h = vaddq_u32(h, vld1q_u32(data + i));
+        h = veorq_u32(h, vshlq_n_u32(h, 13));
+        h = veorq_u32(h, vshrq_n_u32(h, 17));
+        h = vaddq_u32(h, vshlq_n_u32(h, 5));
+    }
+    
+    vst1q_u32(lanes, h);
+#endif
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        for (int l = 0; l < 4; l++)
+        {
+            uint32_t v = lanes[l] + data[i + l];
+            v ^= v << 13;
+            v ^= v >> 17;
+            lanes[l] = v + (v << 5);
+        }
+    }
+    
+    uint64_t h64 = ((uint64_t)lanes[0] << 32 | lanes[1]) ^ ((uint64_t)lanes[2] << 32 | lanes[3]) * 0x9e3779b97f4a7c15ull;
+    h64 ^= h64 >> 29;
+    h64 *= 0xbf58476d1ce4e5b9ull;
+    return h64 ^ (h64 >> 32);
+}
+
+tile_set::tile_set(int size)
+{
+    _size = size;
+}
+
+uint32_t tile_set::insert(const uint32_t *tile)
+{
+    int pixels = _size * _size;
+    uint64_t h = hash_tile(tile, pixels);
+    
+    auto range = _lookup.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (memcmp(_tiles.data() + (size_t)it->second * pixels, tile, pixels * 4) == 0)
+            return it->second;
+    }
+    
+    uint32_t index = (uint32_t)count();
+    _tiles.insert(_tiles.end(), tile, tile + pixels);
+    _lookup.emplace(h, index);
+    return index;
+}
+
+void tile_set::add(const uint32_t *pixels, int width, int height, std::vector<uint32_t>& map)
+{
+    int columns = (width + _size - 1) / _size;
+    int rows = (height + _size - 1) / _size;
+    
+    map.resize(columns * rows);
+    
+    std::vector<uint32_t> tile(_size * _size);
+    
+    for (int ty = 0; ty < rows; ty++)
+    {
+        for (int tx = 0; tx < columns; tx++)
+        {
+            int w = std::min(_size, width - tx * _size);
+            int h = std::min(_size, height - ty * _size);
+            
+            if (w < _size || h < _size)
+                std::fill(tile.begin(), tile.end(), 0);
+            
+            for (int y = 0; y < h; y++)
+            {
+                memcpy(tile.data() + y * _size, pixels + (ty * _size + y) * width + tx * _size, w * 4);
+            }
+            
+            map[ty * columns + tx] = insert(tile.data());
+        }
+    }
+}
+
+void tile_set::render(std::vector<uint32_t>& sheet, int& width, int& height) const
+{
+    int n = (int)count();
+    int columns = std::max(1, (int)ceil(sqrt((double)n)));
+    int rows = std::max(1, (n + columns - 1) / columns);
+    
+    width = columns * _size;
+    height = rows * _size;
+    sheet.assign(width * height, 0);
+    
+    for (int i = 0; i < n; i++)
+    {
+        const uint32_t *tile = _tiles.data() + (size_t)i * _size * _size;
+        uint32_t *dst = sheet.data() + (i / columns) * _size * width + (i % columns) * _size;
+        for (int y = 0; y < _size; y++)
+        {
+            memcpy(dst + y * width, tile + y * _size, _size * 4);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+//
+//  tiles.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef tiles_hpp
+#define tiles_hpp
+
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+// Set of unique square RGBA tiles. Bitmaps are cut into tiles, each tile is looked
+// up by hash (compared in full on a hit) and only new ones are stored.
+
+class tile_set {
+    
+public:
+    
+    tile_set(int size = 8);
+    
+    // tile indices of bitmap row by row, edge tiles are padded with transparent pixels
+    void add(const uint32_t *pixels, int width, int height, std::vector<uint32_t>& map);
+    
+    // all tiles in rows, as close to square as possible
+    void render(std::vector<uint32_t>& sheet, int& width, int& height) const;
+    
+    int size() const { return _size; }
+    size_t count() const { return _tiles.size() / (_size * _size); }
+    
+private:
+    
+    uint32_t insert(const uint32_t *tile);
+    
+    int _size;
+    std::vector<uint32_t> _tiles;
+    std::unordered_multimap<uint64_t, uint32_t> _lookup;
+};
+
+#endif /* tiles_hpp */
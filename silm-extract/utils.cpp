@@ -7,6 +7,17 @@
 
 #include "utils.hpp"
 
+#include <atomic>
+#include <condition_variable>
+#include <fcntl.h>
+#include <mutex>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
 
 std::string utils::get_file_name(std::string filePath, bool withExtension, char seperator)
 {
@@ -32,3 +43,227 @@ std::string utils::get_file_ext(std::string filePath)
     
     return "";
 }
+
+// NOTE: workers stay for the whole run, so what they keep per thread (png_encoder::local)
+// serves every parallel_for instead of being built again for each call
+
+class worker_pool {
+    
+public:
+    
+    worker_pool(size_t threads)
+    {
+        _job = NULL;
+        _count = 0;
+        _next = 0;
+        _active = 0;
+        _generation = 0;
+        _quit = false;
+        
+        for (size_t t = 0; t < threads; t++)
+            _threads.emplace_back([this]() { work(); });
+    }
+    
+    ~worker_pool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _quit = true;
+        }
+        
+        _wake.notify_all();
+        for (auto &t : _threads)
+            t.join();
+    }
+    
+    // calling thread takes part as well, returns when all jobs are done
+    void run(size_t count, const std::function<void(size_t)>& job)
+    {
+        {
+            // a late worker of previous call may still be leaving, it must not see the new counter
+            std::unique_lock<std::mutex> lock(_lock);
+            _done.wait(lock, [&]() { return _active == 0; });
+            
+            _job = &job;
+            _count = count;
+            _next = 0;
+            _generation++;
+        }
+        
+        _wake.notify_all();
+        
+        for (size_t i = _next++; i < count; i = _next++)
+            job(i);
+        
+        std::unique_lock<std::mutex> lock(_lock);
+        _done.wait(lock, [&]() { return _active == 0; });
+    }
+    
+    std::mutex busy;
+    
+private:
+    
+    void work()
+    {
+        uint64_t seen = 0;
+        
+        std::unique_lock<std::mutex> lock(_lock);
+        while (true)
+        {
+            _wake.wait(lock, [&]() { return _quit || _generation != seen; });
+            if (_quit)
+                return;
+            
+            seen = _generation;
+            const std::function<void(size_t)> *job = _job;
+            size_t count = _count;
+            _active++;
+            lock.unlock();
+            
+            for (size_t i = _next++; i < count; i = _next++)
+                (*job)(i);
+            
+            lock.lock();
+            if (--_active == 0)
+                _done.notify_all();
+        }
+    }
+    
+    std::vector<std::thread> _threads;
+    std::mutex _lock;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    
+    const std::function<void(size_t)> *_job;
+    size_t _count;
+    std::atomic<size_t> _next;
+    size_t _active;
+    uint64_t _generation;
+    bool _quit;
+};
+
+void utils::parallel_for(size_t count, const std::function<void(size_t)>& job)
+{
+    static size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    if (std::min(cores, count) <= 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            job(i);
+
+        return;
+    }
+    
+    static worker_pool pool(cores - 1);
+    
+    // pool is taken (call from inside a job, or from another thread), this one runs here
+    
+    std::unique_lock<std::mutex> lock(pool.busy, std::try_to_lock);
+    if (lock.owns_lock() == false)
+    {
+        for (size_t i = 0; i < count; i++)
+            job(i);
+        
+        return;
+    }
+    
+    pool.run(count, job);
+}
+
+static std::filesystem::path part_path(const std::filesystem::path& path)
+{
+    std::filesystem::path part = path;
+    return part += ".part";
+}
+
+FILE *utils::open_output(const std::filesystem::path& path)
+{
+    return fopen(part_path(path).string().c_str(), "wb");
+}
+
+void utils::close_output(FILE *fp, const std::filesystem::path& path)
+{
+    if (fclose(fp) != 0)
+        abort();
+    
+    std::error_code ec;
+    std::filesystem::rename(part_path(path), path, ec);
+    if (ec)
+        abort();
+}
+
+utils::mapped_file::~mapped_file()
+{
+    if (_data)
+        munmap((void *)_data, _size);
+}
+
+bool utils::mapped_file::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            _data = (const uint8_t *)map;
+            _size = st.st_size;
+        }
+    }
+    
+    ::close(fd);
+    return _data != NULL;
+}
+
+utils::memory_file::~memory_file()
+{
+    if (_fd >= 0)
+    {
+        ::close(_fd);
+    }
+    else if (_path.empty() == false)
+    {
+        std::error_code ec;
+        std::filesystem::remove(_path, ec);
+    }
+}
+
+bool utils::memory_file::open(const std::string& name, const uint8_t *data, size_t size)
+{
+#if defined(__linux__)
+    _fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+    if (_fd >= 0)
+    {
+        size_t done = 0;
+        while (done < size)
+        {
+            ssize_t n = ::write(_fd, data + done, size - done);
+            if (n <= 0)
+                break;
+            
+            done += n;
+        }
+        
+        if (done == size)
+        {
+            _path = "/proc/self/fd/" + std::to_string(_fd);
+            return true;
+        }
+        
+        ::close(_fd);
+        _fd = -1;
+    }
+#endif
+    
+    _path = std::filesystem::temp_directory_path() / ("silm-" + std::to_string(getpid()) + "-" + name);
+    
+    FILE *fp = fopen(_path.string().c_str(), "wb");
+    if (!fp)
+        return false;
+    
+    bool written = size == 0 || fwrite(data, size, 1, fp) == 1;
+    return fclose(fp) == 0 && written;
+}
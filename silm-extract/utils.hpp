@@ -8,12 +8,69 @@
 #ifndef utils_hpp
 #define utils_hpp
 
+#include <filesystem>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <string>
 
 namespace utils {
 
     std::string get_file_name(std::string filePath, bool withExtension = true, char seperator = '/');
     std::string get_file_ext(std::string filePath);
+
+    // runs job(0) ... job(count - 1) spread over all available cores (workers are kept between calls)
+    void parallel_for(size_t count, const std::function<void(size_t)>& job);
+
+    // output goes to a sibling file renamed over path on close, so nobody
+    // (e.g. a viewer while --watch re-extracts) ever sees it half written
+    FILE *open_output(const std::filesystem::path& path);
+    void close_output(FILE *fp, const std::filesystem::path& path);
+    
+    // read only memory map of a whole file, unmapped with the object
+    class mapped_file {
+        
+    public:
+        
+        mapped_file() { _data = NULL; _size = 0; }
+        ~mapped_file();
+        
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        
+        bool open(const std::string& path);
+        
+        const uint8_t *data() const { return _data; }
+        size_t size() const { return _size; }
+        
+    private:
+        
+        const uint8_t *_data;
+        size_t _size;
+    };
+    
+    // data in memory reachable by path, for code that only reads files; anonymous
+    // memory file where there are such (linux), temporary file otherwise
+    class memory_file {
+        
+    public:
+        
+        memory_file() { _fd = -1; }
+        ~memory_file();
+        
+        memory_file(const memory_file&) = delete;
+        memory_file& operator=(const memory_file&) = delete;
+        
+        bool open(const std::string& name, const uint8_t *data, size_t size);
+        
+        const std::filesystem::path& path() const { return _path; }
+        
+    private:
+        
+        int _fd;
+        std::filesystem::path _path;
+    };
 }
 
 #endif /* utils_hpp */
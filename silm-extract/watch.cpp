@@ -0,0 +1,129 @@
+//
+//  watch.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "watch.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <set>
+#include <thread>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// events closer than this belong to one save
+static const int quiet_ms = 30;
+
+#if defined(__linux__)
+
+void watch::run(const std::filesystem::path& dir, const std::function<void(const std::filesystem::path&)>& changed)
+{
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cout << "Failed to watch " << dir.string() << std::endl;
+        if (fd >= 0)
+            close(fd);
+        
+        return;
+    }
+    
+    alignas(struct inotify_event) char events[16 * 1024];
+    std::set<std::string> pending;
+    
+    while (true)
+    {
+        // block until something happens, then collect until it calms down
+        
+        struct pollfd p = { fd, POLLIN, 0 };
+        int ready = poll(&p, 1, pending.empty() ? -1 : quiet_ms);
+        if (ready < 0)
+            break;
+        
+        if (ready == 0)
+        {
+            for (const std::string& name : pending)
+                changed(dir / name);
+            
+            pending.clear();
+            continue;
+        }
+        
+        ssize_t length = read(fd, events, sizeof(events));
+        if (length <= 0)
+            break;
+        
+        for (char *e = events; e < events + length; )
+        {
+            struct inotify_event *event = (struct inotify_event *)e;
+            if (event->len)
+                pending.insert(event->name);
+            
+            e += sizeof(struct inotify_event) + event->len;
+        }
+    }
+    
+    close(fd);
+}
+
+#else
+
+// NOTE: no inotify, modification times are polled instead
+
+void watch::run(const std::filesystem::path& dir, const std::function<void(const std::filesystem::path&)>& changed)
+{
+    typedef std::pair<std::filesystem::file_time_type, uintmax_t> stamp;
+    
+    auto snapshot = [&](std::map<std::filesystem::path, stamp>& files) {
+        
+        std::error_code ec;
+        files.clear();
+        for (const auto& file : std::filesystem::directory_iterator(dir, ec))
+        {
+            if (file.is_regular_file(ec))
+                files[file.path()] = { file.last_write_time(ec), file.file_size(ec) };
+        }
+    };
+    
+    std::map<std::filesystem::path, stamp> last, now;
+    snapshot(last);
+    
+    std::set<std::filesystem::path> pending;
+    
+    while (true)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(pending.empty() ? 100 : quiet_ms));
+        snapshot(now);
+        
+        bool quiet = true;
+        for (const auto& f : now)
+        {
+            auto l = last.find(f.first);
+            if (l == last.end() || l->second != f.second)
+            {
+                pending.insert(f.first);
+                quiet = false;
+            }
+        }
+        
+        last.swap(now);
+        
+        if (quiet && pending.size())
+        {
+            for (const std::filesystem::path& file : pending)
+                changed(file);
+            
+            pending.clear();
+        }
+    }
+}
+
+#endif
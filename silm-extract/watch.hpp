@@ -0,0 +1,21 @@
+//
+//  watch.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef watch_hpp
+#define watch_hpp
+
+#include <filesystem>
+#include <functional>
+
+namespace watch {
+
+    // blocks and reports files of dir (not below) that were written or moved in, as editors
+    // often save by rename; the burst of events one save makes is reported once
+    void run(const std::filesystem::path& dir, const std::function<void(const std::filesystem::path&)>& changed);
+}
+
+#endif /* watch_hpp */
@@ -39,18 +39,13 @@ typedef struct wavfile_header_s
 #define BLOCK_ALIGN     (NUM_CHANNELS * BITS_PER_SAMPLE / 8)
 
 
-int write_wav_header(FILE *file_p, int32_t sample_rate, int32_t frame_count)
+inline wavfile_header_t wav_header_for(int32_t sample_rate, int32_t frame_count, int bits_per_sample = 8)
 {
-    int ret;
-    
     wavfile_header_t wav_header;
     int32_t subchunk2_size;
     int32_t chunk_size;
     
-    size_t write_count;
-    
     int num_channels = 1;
-    int bits_per_sample = 8;
     
     subchunk2_size  = frame_count * num_channels * bits_per_sample / 8;
     chunk_size      = 4 + (8 + SUBCHUNK1SIZE) + (8 + subchunk2_size);
@@ -86,11 +81,7 @@ int write_wav_header(FILE *file_p, int32_t sample_rate, int32_t frame_count)
     wav_header.Subchunk2ID[3] = 'a';
     wav_header.Subchunk2Size = subchunk2_size;
     
-    write_count = fwrite(&wav_header, sizeof(wavfile_header_t), 1, file_p);
-                    
-    ret = (1 != write_count) ? -1 : 0;
-    
-    return ret;
+    return wav_header;
 }
 
 #endif /* wav_h */
@@ -0,0 +1,133 @@
+//
+//  zip_archive.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#include "zip_archive.hpp"
+
+#include <algorithm>
+#include <zlib.h>
+
+// NOTE: all values little endian, zip64 and encrypted members are not supported
+
+#define ZIP_END             0x06054b50
+#define ZIP_CENTRAL         0x02014b50
+#define ZIP_LOCAL           0x04034b50
+
+static uint16_t le16(const uint8_t *p)
+{
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool zip_archive::is_zip(const std::filesystem::path& path)
+{
+    std::string e = path.extension().string();
+    std::transform(e.begin(), e.end(), e.begin(), ::tolower);
+    return e == ".zip";
+}
+
+bool zip_archive::open(const std::filesystem::path& path)
+{
+    if (_map.open(path.string()) == false || _map.size() < 22)
+        return false;
+    
+    const uint8_t *data = _map.data();
+    size_t size = _map.size();
+    
+    // end record is the last 22 bytes plus a comment of up to 64k
+    
+    size_t end = size - 22;
+    size_t stop = size > 22 + 0xffff ? size - 22 - 0xffff : 0;
+    while (le32(data + end) != ZIP_END)
+    {
+        if (end == stop)
+            return false;
+        
+        end--;
+    }
+    
+    uint32_t count = le16(data + end + 10);
+    size_t at = le32(data + end + 16);
+    
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (at + 46 > size || le32(data + at) != ZIP_CENTRAL)
+            return false;
+        
+        const uint8_t *c = data + at;
+        uint16_t flags = le16(c + 8);
+        uint16_t name_length = le16(c + 28);
+        size_t next = at + 46 + name_length + le16(c + 30) + le16(c + 32);
+        if (next > size)
+            return false;
+        
+        member m;
+        m.name = std::string((const char *)c + 46, name_length);
+        m.method = le16(c + 10);
+        m.crc = le32(c + 16);
+        m.packed_size = le32(c + 20);
+        m.size = le32(c + 24);
+        m.header = le32(c + 42);
+        
+        if ((flags & 1) == 0 && (m.method == 0 || m.method == Z_DEFLATED) && m.name.size() && m.name.back() != '/')
+            _members.push_back(m);
+        
+        at = next;
+    }
+    
+    return true;
+}
+
+bool zip_archive::read(const member& m, std::vector<uint8_t>& out) const
+{
+    const uint8_t *data = _map.data();
+    size_t size = _map.size();
+    
+    if ((size_t)m.header + 30 > size || le32(data + m.header) != ZIP_LOCAL)
+        return false;
+    
+    size_t from = (size_t)m.header + 30 + le16(data + m.header + 26) + le16(data + m.header + 28);
+    if (from + m.packed_size > size)
+        return false;
+    
+    // deflate can not do better than about 1:1032, anything claiming more is broken
+    
+    if (m.size > (uint64_t)m.packed_size * 1032 + 64)
+        return false;
+    
+    out.resize(m.size);
+    
+    if (m.method == 0)
+    {
+        if (m.packed_size != m.size)
+            return false;
+        
+        std::copy(data + from, data + from + m.size, out.begin());
+    }
+    else
+    {
+        z_stream zs = {};
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+            return false;
+        
+        zs.next_in = (Bytef *)(data + from);
+        zs.avail_in = m.packed_size;
+        zs.next_out = out.data();
+        zs.avail_out = m.size;
+        
+        int res = inflate(&zs, Z_FINISH);
+        inflateEnd(&zs);
+        
+        if (res != Z_STREAM_END || zs.total_out != m.size)
+            return false;
+    }
+    
+    return crc32(0, out.data(), m.size) == m.crc;
+}
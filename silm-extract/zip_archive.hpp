@@ -0,0 +1,50 @@
+//
+//  zip_archive.hpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+
+#ifndef zip_archive_hpp
+#define zip_archive_hpp
+
+#include <filesystem>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+
+// Read only zip access. The archive is memory mapped and its central directory
+// read once, members (stored or deflated) are inflated straight into memory.
+
+class zip_archive {
+    
+public:
+    
+    struct member {
+        
+        std::string name;
+        uint16_t method;
+        uint32_t crc;
+        uint32_t packed_size;
+        uint32_t size;
+        uint32_t header;        // offset of local header
+    };
+    
+    static bool is_zip(const std::filesystem::path& path);
+    
+    bool open(const std::filesystem::path& path);
+    
+    const std::vector<member>& members() const { return _members; }
+    
+    // thread safe, every call inflates on its own stream
+    bool read(const member& m, std::vector<uint8_t>& out) const;
+    
+private:
+    
+    utils::mapped_file _map;
+    std::vector<member> _members;
+};
+
+#endif /* zip_archive_hpp */
@@ -0,0 +1,192 @@
+//
+//  fli_seek.cpp
+//  silm-extract
+//
+//  Created on 18.10.2026.
+//
+//  Random access through the FLI seek index has to give the same frames as sequential decode.
+//  g++ -std=gnu++17 -I silm-extract tests/fli_seek.cpp silm-extract/fli.cpp -o fli_seek && ./fli_seek
+//
+
+#include "fli.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const int width = 32;
+static const int height = 24;
+static const int frames = 70;
+
+static void put16(std::vector<uint8_t>& out, uint16_t v)
+{
+    out.push_back(v & 0xff);
+    out.push_back(v >> 8);
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t v)
+{
+    put16(out, v & 0xffff);
+    put16(out, v >> 16);
+}
+
+static void chunk(std::vector<uint8_t>& frame, uint16_t type, const std::vector<uint8_t>& data)
+{
+    put32(frame, (uint32_t)data.size() + 6);
+    put16(frame, type);
+    frame.insert(frame.end(), data.begin(), data.end());
+}
+
+static void frame(std::vector<uint8_t>& out, const std::vector<std::vector<uint8_t>>& chunks)
+{
+    std::vector<uint8_t> body;
+    for (size_t c = 0; c < chunks.size(); c += 2)
+        chunk(body, chunks[c][0] | (chunks[c][1] << 8), chunks[c + 1]);
+    
+    put32(out, (uint32_t)body.size() + 16);
+    put16(out, fli_frame);
+    put16(out, (uint16_t)(chunks.size() / 2));
+    out.resize(out.size() + 8, 0);
+    out.insert(out.end(), body.begin(), body.end());
+}
+
+static std::vector<uint8_t> type(uint16_t t)
+{
+    return { (uint8_t)(t & 0xff), (uint8_t)(t >> 8) };
+}
+
+// FLC with full first frame, every later frame changes a few pixels of one line and sometimes one color
+static std::vector<uint8_t> make_video()
+{
+    std::vector<uint8_t> out(128, 0);
+    out[4] = 0x12;
+    out[5] = 0xAF;
+    out[6] = frames;
+    out[8] = width;
+    out[10] = height;
+    out[12] = 8;
+    out[80] = 128;
+    
+    std::vector<uint8_t> colors;
+    put16(colors, 1);
+    colors.push_back(0);
+    colors.push_back(0);
+    for (int c = 0; c < 256 * 3; c++)
+        colors.push_back((uint8_t)(c * 7));
+    
+    std::vector<uint8_t> run;
+    for (int y = 0; y < height; y++)
+    {
+        run.push_back(1);
+        run.push_back(width);
+        run.push_back((uint8_t)(y * 5));
+    }
+    
+    frame(out, { type(fli_color256), colors, type(fli_byte_run), run });
+    
+    for (int f = 1; f < frames; f++)
+    {
+        int y = (f * 7) % height;
+        
+        std::vector<uint8_t> delta;
+        put16(delta, 1);
+        if (y > 0)
+            put16(delta, (uint16_t)-y);
+        put16(delta, 1);
+        delta.push_back((uint8_t)((f * 3) % 16));
+        delta.push_back(2);
+        for (int b = 0; b < 4; b++)
+            delta.push_back((uint8_t)(f + b));
+        
+        if (f % 5)
+        {
+            frame(out, { type(fli_delta_flc), delta });
+            continue;
+        }
+        
+        std::vector<uint8_t> color;
+        put16(color, 1);
+        color.push_back((uint8_t)f);
+        color.push_back(1);
+        color.insert(color.end(), { (uint8_t)f, (uint8_t)(f * 2), (uint8_t)(f * 3) });
+        
+        frame(out, { type(fli_color256), color, type(fli_delta_flc), delta });
+    }
+    
+    std::vector<uint8_t> size;
+    put32(size, (uint32_t)out.size());
+    memcpy(out.data(), size.data(), 4);
+    
+    return out;
+}
+
+static std::vector<uint8_t> state(const fli_decoder& fli)
+{
+    std::vector<uint8_t> s(fli.pixels(), fli.pixels() + fli.width() * fli.height());
+    s.insert(s.end(), fli.palette(), fli.palette() + 256 * 3);
+    return s;
+}
+
+int main()
+{
+    std::vector<uint8_t> video = make_video();
+    
+    fli_decoder sequential(video.data(), (uint32_t)video.size());
+    std::vector<std::vector<uint8_t>> expected;
+    while (sequential.decode_next())
+        expected.push_back(state(sequential));
+    
+    if (expected.size() != frames)
+    {
+        printf("sequential decode gave %d of %d frames\n", (int)expected.size(), frames);
+        return 1;
+    }
+    
+    fli_decoder indexed(video.data(), (uint32_t)video.size());
+    if (indexed.build_index(8) != frames)
+    {
+        printf("index covers wrong number of frames\n");
+        return 1;
+    }
+    
+    // backwards, forwards, across keyframes both ways, and scattered
+    
+    std::vector<int> order;
+    for (int n = frames - 1; n >= 0; n--)
+        order.push_back(n);
+    for (int n = 0; n < frames; n++)
+        order.push_back(n);
+    for (int n : { 8, 7, 9, 16, 15, 17, 0, 69, 1, 64, 63 })
+        order.push_back(n);
+    uint32_t seed = 1;
+    for (int n = 0; n < 200; n++)
+    {
+        seed = seed * 1103515245 + 12345;
+        order.push_back((seed >> 16) % frames);
+    }
+    
+    int failed = 0;
+    for (int n : order)
+    {
+        if (indexed.decode_frame(n) == false || state(indexed) != expected[n])
+        {
+            printf("frame %d differs\n", n);
+            failed++;
+        }
+        
+        if (indexed.frame_position(n) == 0)
+        {
+            printf("frame %d has no position\n", n);
+            failed++;
+        }
+    }
+    
+    if (indexed.decode_frame(frames) || indexed.decode_frame(-1))
+    {
+        printf("frame out of range decoded\n");
+        failed++;
+    }
+    
+    printf("%s: %d frames, %d seeks, %d failed\n", failed ? "FAIL" : "OK", frames, (int)order.size(), failed);
+    return failed ? 1 : 0;
+}